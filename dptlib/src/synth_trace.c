@@ -0,0 +1,148 @@
+#include "dptv_trace.h"
+#include <assert.h>
+
+
+
+/*
+Writes a pair of synthetic traces of the same program for benchmarking the viewer.
+The second trace runs the program on a core with faster memory and more branch mispredictions,
+so the two drift apart and have squashed instructions in different places.
+
+usage: synth_trace <trace a> <trace b> <instructions>
+*/
+
+
+
+static uint64_t rng_state;
+
+static uint32_t rng() {
+    // xorshift64*, so both traces see the same program for the same seed
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static char * num_str(uint64_t num) {
+    char buff[32];
+    snprintf(buff, 32, "%" PRIu64, num);
+    return strdup(buff);
+}
+
+static void push_stage(instruction_t * inst, uint64_t cycle, char id, const char * name) {
+    inst_push_stage(inst, new_stage(cycle, id, strdup(name)));
+}
+
+static void write_chunk(FILE * file, trace_t * trace) {
+    // Written through a string buffer, then the written instructions are dropped
+    string_buff_t buff = new_string_buff();
+    trace_write_string(&buff, trace, 0);
+    fputs(buff.str, file);
+    free_string_buff(buff);
+}
+
+static void write_trace(const char * path, uint64_t n_insts, int mem_lat, int mispredict_pct) {
+    FILE * file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "synth_trace: failed to open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    trace_t trace = new_trace();
+    // Same program for both traces, timing drawn from a second stream
+    uint64_t prog_state = 0x9E3779B97F4A7C15ULL;
+    uint64_t time_state = 0xD1B54A32D192ED03ULL + mem_lat;
+    uint64_t fetch = 10;
+    uint64_t last_retire = 0;
+    uint64_t pc = 0x400000;
+    char text[64];
+    for(uint64_t i = 0; i < n_insts; i++) {
+        rng_state = prog_state;
+        uint32_t op = rng() % 10;
+        int rd = rng() % 16;
+        int rs = rng() % 16;
+        int rt = rng() % 16;
+        prog_state = rng_state;
+        rng_state = time_state;
+        const char * kind;
+        int exec_lat = 1;
+        bool mem = false;
+        bool branch = false;
+        if (op < 4) {
+            kind = "alu";
+            snprintf(text, 64, "add r%d, r%d, r%d", rd, rs, rt);
+        } else if (op < 6) {
+            kind = "mem";
+            mem = true;
+            snprintf(text, 64, "ld r%d, [r%d+%d]", rd, rs, rt * 8);
+        } else if (op < 7) {
+            kind = "mem";
+            mem = true;
+            snprintf(text, 64, "st r%d, [r%d+%d]", rd, rs, rt * 8);
+        } else if (op < 8) {
+            kind = "mul";
+            exec_lat = 3;
+            snprintf(text, 64, "mul r%d, r%d, r%d", rd, rs, rt);
+        } else {
+            kind = "branch";
+            branch = true;
+            snprintf(text, 64, "beq r%d, r%d, 0x%" PRIx64, rs, rt, pc + 64);
+        }
+        instruction_t inst = new_inst(1, 0, pc, strdup(text));
+        uint64_t issue = fetch + 3 + rng() % 4;
+        uint64_t done = issue + exec_lat;
+        push_stage(&inst, fetch, 'f', "fetch");
+        push_stage(&inst, fetch + 1, 'd', "decode");
+        push_stage(&inst, fetch + 2, 'n', "rename");
+        push_stage(&inst, issue, 'i', "issue");
+        stage_t * exec = inst_push_stage(&inst, new_stage(issue + 1, 'e', strdup("execute")));
+        stage_push_param(exec, new_param(strdup("unit"), strdup(kind)));
+        stage_push_param(exec, new_param(strdup("latency"), num_str(exec_lat)));
+        if (mem) {
+            // Mostly hits, with the odd long miss
+            int lat = (rng() % 16 == 0) ? mem_lat * 10 : mem_lat;
+            stage_t * m = inst_push_stage(&inst, new_stage(done + 1, 'm', strdup("memory")));
+            stage_push_param(m, new_param(strdup("addr"), num_str(0x10000000 + (rng() % 4096) * 8)));
+            stage_push_param(m, new_param(strdup("latency"), num_str(lat)));
+            done += 1 + lat;
+        }
+        // Retire in order
+        uint64_t retire = (done + 1 > last_retire) ? done + 1 : last_retire;
+        push_stage(&inst, retire, 'R', "retire");
+        last_retire = retire;
+        trace_push_inst(&trace, inst);
+        pc += 4;
+
+        if (branch && (int)(rng() % 100) < mispredict_pct) {
+            // Wrong path fetched until the branch resolves, then squashed
+            uint64_t wrong_pc = pc + 64;
+            for(uint64_t c = fetch + 1; c < done; c++) {
+                instruction_t sq = new_inst(1, 0, wrong_pc, strdup("nop"));
+                push_stage(&sq, c, 'f', "fetch");
+                push_stage(&sq, c + 1, 'd', "decode");
+                trace_push_inst(&trace, sq);
+                wrong_pc += 4;
+            }
+            fetch = done + 1;
+        } else {
+            fetch += rng() % 2;
+        }
+        time_state = rng_state;
+
+        // Appending to a string buffer gets slower as it grows, so write as
+        // soon as each instruction is done
+        write_chunk(file, &trace);
+    }
+    trace_free(&trace);
+    fclose(file);
+}
+
+int main(int argc, char * argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <trace a> <trace b> <instructions>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    uint64_t n_insts = strtoull(argv[3], NULL, 10);
+    write_trace(argv[1], n_insts, 4, 10);
+    write_trace(argv[2], n_insts, 2, 20);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,290 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "dptv.h"
+#include "options.h"
+#include "trace_handler.h"
+#include "align_cache.h"
+
+// Sidecar layout: the magic string, then unsigned LEB128 varints for the two
+// content hashes, the instruction counts, the -dd/-dc settings, the start/end
+// cutoffs, and for each trace its row count followed by its row map as runs.
+// A run is (length<<1 | pad), and a run of real rows is followed by the
+// zigzag-encoded jump from where the previous run left off.
+static const char sidecar_magic[8] = "DPTVALN1";
+static const char *sidecar_ext = ".dptvalign";
+
+typedef struct buf_type {
+    uint8_t *data;
+    uint64_t len;
+    uint64_t size;
+    uint64_t pos;
+} buf_t;
+
+static char * sidecar_path();
+static void put_varint(buf_t *, uint64_t);
+static bool get_varint(buf_t *, uint64_t *);
+static void put_map(buf_t *, int64_t *, uint64_t);
+static bool get_map(buf_t *, int64_t *, uint64_t, uint64_t);
+
+void free_align_map(align_map_t * a) {
+    if (a == NULL) {
+        return;
+    }
+    free(a->map[0]);
+    free(a->map[1]);
+    free(a);
+}
+
+// FNV-1a over the pc and commit state of every instruction, which is all the
+// alignment looks at
+uint64_t trace_content_hash(trace_t * trace) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(uint64_t i = 0; i < trace->n_insts; i++) {
+        instruction_t *inst = &trace->insts[i];
+        for(const char *c = inst->pc_text; *c != '\0'; c++) {
+            h = (h ^ (uint8_t)*c) * 0x100000001b3ULL;
+        }
+        h = (h ^ (inst->committed ? 0xffu : 0xfeu)) * 0x100000001b3ULL;
+    }
+    return h ^ trace->n_insts;
+}
+
+align_map_t * load_align_sidecar(uint64_t * hashes) {
+    char *path = sidecar_path();
+    FILE *fd = fopen(path, "rb");
+    free(path);
+    if (fd == NULL) {
+        return NULL;
+    }
+    buf_t b = {NULL, 0, 0, 0};
+    fseek(fd, 0, SEEK_END);
+    long size = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+    if (size > (long)sizeof(sidecar_magic)) {
+        b.data = malloc(size);
+        assert(b.data);
+        b.len = fread(b.data, 1, size, fd);
+    }
+    fclose(fd);
+    if (b.len != (uint64_t)size || memcmp(b.data, sidecar_magic, sizeof(sidecar_magic)) != 0) {
+        free(b.data);
+        return NULL;
+    }
+    b.pos = sizeof(sidecar_magic);
+
+    // Header must match the traces and options of this run
+    uint64_t v[10];
+    bool ok = true;
+    for(int i = 0; i < 10 && ok; i++) {
+        ok = get_varint(&b, &v[i]);
+    }
+    ok = ok && v[0] == hashes[0] && v[1] == hashes[1];
+    ok = ok && v[2] == TRACES[0]->n_insts && v[3] == TRACES[1]->n_insts;
+    ok = ok && v[4] == (uint64_t)(OPTIONS->trace_disable_dummy != 0);
+    ok = ok && v[5] == (uint64_t)(OPTIONS->trace_disable_cutoff != 0);
+    if (!ok) {
+        free(b.data);
+        return NULL;
+    }
+
+    align_map_t *a = malloc(sizeof(align_map_t));
+    assert(a);
+    a->map[0] = NULL;
+    a->map[1] = NULL;
+    a->disable_dummy = v[4];
+    a->disable_cutoff = v[5];
+    for(int t = 0; t < 2; t++) {
+        a->n_src[t] = v[2+t];
+        a->start[t] = v[6+t];
+        a->end[t] = v[8+t];
+    }
+    for(int t = 0; t < 2; t++) {
+        // Every row holds a real instruction from at least one trace
+        if (!ok || !get_varint(&b, &a->n_rows[t]) || a->n_rows[t] > a->n_src[0] + a->n_src[1]) {
+            ok = false;
+            break;
+        }
+        a->map[t] = malloc(sizeof(int64_t) * (a->n_rows[t] + 1));
+        assert(a->map[t]);
+        ok = get_map(&b, a->map[t], a->n_rows[t], a->n_src[t]);
+    }
+    free(b.data);
+    if (!ok) {
+        free_align_map(a);
+        return NULL;
+    }
+    return a;
+}
+
+void save_align_sidecar(align_map_t * a, uint64_t * hashes) {
+    buf_t b = {NULL, 0, 0, 0};
+    b.size = 256;
+    b.data = malloc(b.size);
+    assert(b.data);
+    memcpy(b.data, sidecar_magic, sizeof(sidecar_magic));
+    b.len = sizeof(sidecar_magic);
+
+    put_varint(&b, hashes[0]);
+    put_varint(&b, hashes[1]);
+    put_varint(&b, a->n_src[0]);
+    put_varint(&b, a->n_src[1]);
+    put_varint(&b, a->disable_dummy != 0);
+    put_varint(&b, a->disable_cutoff != 0);
+    put_varint(&b, a->start[0]);
+    put_varint(&b, a->start[1]);
+    put_varint(&b, a->end[0]);
+    put_varint(&b, a->end[1]);
+    for(int t = 0; t < 2; t++) {
+        put_varint(&b, a->n_rows[t]);
+        put_map(&b, a->map[t], a->n_rows[t]);
+    }
+
+    // Write to a temporary file first so a partial write is never picked up
+    char *path = sidecar_path();
+    char *tmp = malloc(strlen(path) + 5);
+    assert(tmp);
+    sprintf(tmp, "%s.tmp", path);
+    FILE *fd = fopen(tmp, "wb");
+    if (fd != NULL) {
+        bool ok = fwrite(b.data, 1, b.len, fd) == b.len;
+        ok = (fclose(fd) == 0) && ok;
+        if (!ok || rename(tmp, path) != 0) {
+            remove(tmp);
+        }
+    }
+    free(tmp);
+    free(path);
+    free(b.data);
+}
+
+static char * sidecar_path() {
+    char *name = OPTIONS->trace_filenames[0];
+    char *path = malloc(strlen(name) + strlen(sidecar_ext) + 1);
+    assert(path);
+    sprintf(path, "%s%s", name, sidecar_ext);
+    return path;
+}
+
+static void put_varint(buf_t * b, uint64_t v) {
+    if (b->len + 10 > b->size) {
+        b->size *= 2;
+        b->data = realloc(b->data, b->size);
+        assert(b->data);
+    }
+    while (v >= 0x80) {
+        b->data[b->len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    b->data[b->len++] = (uint8_t)v;
+}
+
+static bool get_varint(buf_t * b, uint64_t * v) {
+    *v = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+        if (b->pos >= b->len) {
+            return false;
+        }
+        uint8_t byte = b->data[b->pos++];
+        *v |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void put_map(buf_t * b, int64_t * map, uint64_t n) {
+    // Count the runs first so the reader knows when to stop
+    uint64_t n_runs = 0;
+    for(uint64_t i = 0; i < n; i++) {
+        if (i == 0 || (map[i] < 0) != (map[i-1] < 0) || (map[i] >= 0 && map[i] != map[i-1] + 1)) {
+            n_runs ++;
+        }
+    }
+    put_varint(b, n_runs);
+    uint64_t r = 0;
+    int64_t next = 0;
+    while (r < n) {
+        uint64_t len = 1;
+        if (map[r] < 0) {
+            while (r + len < n && map[r+len] < 0) len ++;
+            put_varint(b, len << 1 | 1);
+        } else {
+            while (r + len < n && map[r+len] == map[r] + (int64_t)len) len ++;
+            int64_t jump = map[r] - next;
+            put_varint(b, len << 1);
+            put_varint(b, ((uint64_t)jump << 1) ^ (uint64_t)(jump >> 63));
+            next = map[r] + len;
+        }
+        r += len;
+    }
+}
+
+static bool get_map(buf_t * b, int64_t * map, uint64_t n, uint64_t n_src) {
+    uint64_t n_runs;
+    if (!get_varint(b, &n_runs)) {
+        return false;
+    }
+    uint64_t r = 0;
+    int64_t next = 0;
+    for(uint64_t k = 0; k < n_runs; k++) {
+        uint64_t run, zz;
+        if (!get_varint(b, &run)) {
+            return false;
+        }
+        uint64_t len = run >> 1;
+        if (len == 0 || len > n - r) {
+            return false;
+        }
+        if (run & 1) {
+            for(uint64_t i = 0; i < len; i++) map[r++] = -1;
+            continue;
+        }
+        if (!get_varint(b, &zz)) {
+            return false;
+        }
+        int64_t first = next + (int64_t)((zz >> 1) ^ -(zz & 1));
+        if (first < 0 || (uint64_t)first + len > n_src) {
+            return false;
+        }
+        for(uint64_t i = 0; i < len; i++) map[r++] = first + i;
+        next = first + len;
+    }
+    return r == n && b->pos <= b->len;
+}
@@ -0,0 +1,198 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "dptv.h"
+#include "options.h"
+#include "gfx.h"
+#include "event.h"
+#include "search.h"
+#include "lod.h"
+#include "bench.h"
+
+// Groups of camera operations, reported separately
+#define BENCH_PAN       0
+#define BENCH_ZOOM      1
+#define BENCH_SEARCH    2
+#define BENCH_JUMP      3
+#define BENCH_GROUPS    4
+
+static const char *bench_names[BENCH_GROUPS] = {"pan", "zoom", "search", "jump"};
+// Text searched for, found in the synthetic traces
+static const char *bench_pattern = "ld";
+
+static double *frame_ms[BENCH_GROUPS];
+static int n_frames[BENCH_GROUPS];
+static int cap_frames[BENCH_GROUPS];
+static uint64_t op_start;
+
+static void bench_begin();
+static void bench_end(int);
+static void bench_settle();
+static void bench_report(const char *, double *, int);
+
+// Drive a fixed sequence of camera operations through the same calls the
+// event loop makes, drawing a frame after each, and report the frame rate
+// and frame times. Runs headless, so nothing waits on the display.
+int run_bench_render(int passes) {
+    // Mouse over the middle of the stage area, where zooms are centered
+    mx = instr_surf_width + (OPTIONS->win_width - instr_surf_width) / 2;
+    my = OPTIONS->win_height / 2;
+    // Far zoomed out views are drawn from the pyramid, so wait for it
+    start_lod_build();
+    wait_lod_build();
+    gfx_mark_dirty(DIRTY_ALL);
+    gfx_update();
+
+    for(int p = 0; p < passes; p++) {
+        gfx_move_to_first();
+        // Steady scrolling, one cell then one fast step at a time
+        for(int i = 0; i < 120; i++) {
+            bench_begin();  gfx_move(1, 0, false);  bench_end(BENCH_PAN);
+        }
+        for(int i = 0; i < 120; i++) {
+            bench_begin();  gfx_move(0, 1, false);  bench_end(BENCH_PAN);
+        }
+        for(int i = 0; i < 60; i++) {
+            bench_begin();  gfx_move(0, 1, true);   bench_end(BENCH_PAN);
+        }
+        for(int i = 0; i < 60; i++) {
+            bench_begin();  gfx_move(-1, 0, true);  bench_end(BENCH_PAN);
+        }
+        // Zoom out a long way, scroll around out there, and come back
+        for(int i = 0; i < 24; i++) {
+            bench_begin();  gfx_inc_scale(mx, my);  bench_end(BENCH_ZOOM);
+        }
+        bench_settle();
+        for(int i = 0; i < 60; i++) {
+            bench_begin();  gfx_move(0, 1, true);   bench_end(BENCH_PAN);
+        }
+        for(int i = 0; i < 24; i++) {
+            bench_begin();  gfx_dec_scale(mx, my);  bench_end(BENCH_ZOOM);
+        }
+        bench_settle();
+        // Search, then step through the matches as n does
+        bench_begin();
+        search_input_begin(false);
+        search_input_key('/');
+        for(const char *c = bench_pattern; *c != '\0'; c++) {
+            search_input_key(*c);
+        }
+        search_input_finish();
+        bench_end(BENCH_SEARCH);
+        for(int i = 0; i < 30; i++) {
+            bench_begin();
+            int64_t x = -1;
+            int64_t y = search_find(true, &x);
+            gfx_look_at(y, x);
+            bench_end(BENCH_SEARCH);
+        }
+        bench_begin();  search_end();  bench_end(BENCH_SEARCH);
+        // Jumps across the whole trace
+        bench_begin();  gfx_move_to_last();     bench_end(BENCH_JUMP);
+        bench_begin();  gfx_snap();             bench_end(BENCH_JUMP);
+        bench_begin();  gfx_move_to_first();    bench_end(BENCH_JUMP);
+        bench_begin();  gfx_snap();             bench_end(BENCH_JUMP);
+        if (OPTIONS->num_traces > 1) {
+            for(int i = 0; i < 10; i++) {
+                bench_begin();  gfx_jump_divergence(true);  bench_end(BENCH_JUMP);
+            }
+        }
+    }
+    stop_lod_build();
+
+    // Everything together, then each group
+    int n_all = 0;
+    for(int g = 0; g < BENCH_GROUPS; g++) {
+        n_all += n_frames[g];
+    }
+    double *all = malloc(sizeof(double) * (n_all + 1));
+    n_all = 0;
+    for(int g = 0; g < BENCH_GROUPS; g++) {
+        for(int i = 0; i < n_frames[g]; i++) {
+            all[n_all++] = frame_ms[g][i];
+        }
+    }
+    printf("bench-render: %d passes, %dx%d window, %d traces\n", passes, OPTIONS->win_width, OPTIONS->win_height, OPTIONS->num_traces);
+    bench_report("all", all, n_all);
+    for(int g = 0; g < BENCH_GROUPS; g++) {
+        bench_report(bench_names[g], frame_ms[g], n_frames[g]);
+        free(frame_ms[g]);
+    }
+    free(all);
+    return 0;
+}
+
+static void bench_begin() {
+    op_start = SDL_GetPerformanceCounter();
+}
+
+static void bench_settle() {
+    // Stop as the user would after zooming, so the view is drawn fully
+    if (OPTIONS->refine_ms <= 0) return;
+    SDL_Delay(OPTIONS->refine_ms);
+    bench_begin();  gfx_refine();  bench_end(BENCH_ZOOM);
+}
+
+// Draw the frame for the operation just made and file its time
+static void bench_end(int group) {
+    gfx_update();
+    double ms = (double)(SDL_GetPerformanceCounter() - op_start) * 1000 / SDL_GetPerformanceFrequency();
+    if (n_frames[group] == cap_frames[group]) {
+        cap_frames[group] = (cap_frames[group] == 0) ? 256 : cap_frames[group] * 2;
+        frame_ms[group] = realloc(frame_ms[group], sizeof(double) * cap_frames[group]);
+    }
+    frame_ms[group][n_frames[group]++] = ms;
+}
+
+static int bench_cmp(const void * a, const void * b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_report(const char * name, double * ms, int n) {
+    if (n == 0) {
+        return;
+    }
+    qsort(ms, n, sizeof(double), bench_cmp);
+    double sum = 0;
+    for(int i = 0; i < n; i++) {
+        sum += ms[i];
+    }
+    printf("    %-7s %6d frames %9.1f fps   ms avg %7.2f  p50 %7.2f  p90 %7.2f  p99 %7.2f  max %7.2f\n",
+           name, n, n * 1000 / sum, sum / n, ms[n / 2], ms[(n - 1) * 90 / 100], ms[(n - 1) * 99 / 100], ms[n - 1]);
+}
@@ -0,0 +1,247 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dptv.h"
+#include "options.h"
+#include "trace_handler.h"
+#include "diverge.h"
+
+// Runs of diverging rows closer together than this are reported as one
+// region, so a burst of squash-depth differences is visited in one jump
+static const uint64_t diverge_gap = 4;
+// How many of the largest regions to list in the summary
+static const int diverge_top = 5;
+
+diverge_index_t *DIVERGE = NULL;
+
+static bool row_state(uint64_t, int *, bool *);
+static void scan_rows(uint64_t, uint64_t, diverge_t **, uint64_t *, uint64_t *);
+static uint64_t aligned_rows();
+
+// Scan the aligned rows of the two traces and record each divergent region
+void build_diverge_index() {
+    free_diverge_index();
+    if (OPTIONS->num_traces < 2) {
+        return;
+    }
+    DIVERGE = malloc(sizeof(diverge_index_t));
+    assert(DIVERGE);
+    memset(DIVERGE, 0, sizeof(diverge_index_t));
+    DIVERGE->rows = aligned_rows();
+    uint64_t size = 1024;
+    DIVERGE->regions = malloc(sizeof(diverge_t) * size);
+    assert(DIVERGE->regions);
+    scan_rows(0, DIVERGE->rows, &DIVERGE->regions, &DIVERGE->n, &size);
+}
+
+// Rows [r0, r1) were replaced by n_rows rows. Scan only those, along with the
+// regions near enough to join them, and move the regions below.
+void splice_diverge_index(uint64_t r0, uint64_t r1, uint64_t n_rows) {
+    if (DIVERGE == NULL) {
+        build_diverge_index();
+        return;
+    }
+    int64_t delta = (int64_t)n_rows - (int64_t)(r1 - r0);
+    diverge_t *regions = DIVERGE->regions;
+    // Regions [lo, hi) could merge with a divergent row in the window
+    uint64_t lo = 0;
+    uint64_t hi = DIVERGE->n;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (regions[mid].end + diverge_gap <= r0) lo = mid + 1;
+        else                                      hi = mid;
+    }
+    hi = lo;
+    while (hi < DIVERGE->n && regions[hi].start < r1 + diverge_gap) {
+        hi ++;
+    }
+    uint64_t s0 = r0;
+    uint64_t s1 = r1;
+    if (hi > lo) {
+        if (regions[lo].start < s0) s0 = regions[lo].start;
+        if (regions[hi-1].end > s1) s1 = regions[hi-1].end;
+    }
+    for(uint64_t i = lo; i < hi; i++) {
+        DIVERGE->pad[0] -= regions[i].pad[0];
+        DIVERGE->pad[1] -= regions[i].pad[1];
+        DIVERGE->mismatch -= regions[i].mismatch;
+    }
+    uint64_t size = 64;
+    uint64_t n_found = 0;
+    diverge_t *found = malloc(sizeof(diverge_t) * size);
+    assert(found);
+    scan_rows(s0, s1 + delta, &found, &n_found, &size);
+
+    // Put the new regions in place of the old, moving the ones below
+    uint64_t tail = DIVERGE->n - hi;
+    DIVERGE->n = lo + n_found + tail;
+    if (n_found > hi - lo) {
+        DIVERGE->regions = realloc(DIVERGE->regions, sizeof(diverge_t) * DIVERGE->n);
+        assert(DIVERGE->regions);
+        regions = DIVERGE->regions;
+    }
+    memmove(&regions[lo + n_found], &regions[hi], sizeof(diverge_t) * tail);
+    memcpy(&regions[lo], found, sizeof(diverge_t) * n_found);
+    for(uint64_t i = lo + n_found; i < DIVERGE->n; i++) {
+        regions[i].start += delta;
+        regions[i].end += delta;
+    }
+    DIVERGE->rows = aligned_rows();
+    free(found);
+}
+
+void free_diverge_index() {
+    if (DIVERGE != NULL) {
+        free(DIVERGE->regions);
+        free(DIVERGE);
+        DIVERGE = NULL;
+    }
+}
+
+// Print the totals and the largest regions to the console
+void dump_diverge_summary() {
+    if (DIVERGE == NULL) {
+        return;
+    }
+    printf("alignment: %" PRIu64 " rows, %" PRIu64 " divergent regions, %" PRIu64 "/%" PRIu64 " padded rows, %" PRIu64 " mismatched rows\n",
+           DIVERGE->rows, DIVERGE->n, DIVERGE->pad[0], DIVERGE->pad[1], DIVERGE->mismatch);
+    // Pick out the longest regions without sorting the whole index
+    int64_t top[diverge_top];
+    int n_top = 0;
+    for(uint64_t i = 0; i < DIVERGE->n; i++) {
+        uint64_t len = DIVERGE->regions[i].end - DIVERGE->regions[i].start;
+        int j = n_top;
+        while (j > 0 && len > DIVERGE->regions[top[j-1]].end - DIVERGE->regions[top[j-1]].start) {
+            if (j < diverge_top) top[j] = top[j-1];
+            j --;
+        }
+        if (j < diverge_top) {
+            top[j] = i;
+            if (n_top < diverge_top) n_top ++;
+        }
+    }
+    for(int j = 0; j < n_top; j++) {
+        diverge_t *d = &DIVERGE->regions[top[j]];
+        printf("  rows %" PRIu64 "-%" PRIu64 ": %" PRIu64 "/%" PRIu64 " padded, %" PRIu64 " mismatched\n",
+               d->start, d->end - 1, d->pad[0], d->pad[1], d->mismatch);
+    }
+    fflush(stdout);
+}
+
+// Binary search for the first region starting after the given row, or the
+// last region starting before it. Returns -1 if there is none.
+int64_t diverge_find(uint64_t row, bool forward) {
+    if (DIVERGE == NULL) {
+        return -1;
+    }
+    // lo ends up as the number of regions starting at or before row
+    uint64_t lo = 0;
+    uint64_t hi = DIVERGE->n;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (DIVERGE->regions[mid].start <= row) lo = mid + 1;
+        else                                    hi = mid;
+    }
+    if (forward) {
+        return (lo < DIVERGE->n) ? (int64_t)lo : -1;
+    }
+    if (lo > 0 && DIVERGE->regions[lo-1].start == row) lo --;
+    return (int64_t)lo - 1;
+}
+
+// Add the divergent regions of rows [r0, r1) to the end of a list, and their
+// rows to the totals
+static void scan_rows(uint64_t r0, uint64_t r1, diverge_t ** regions, uint64_t * n, uint64_t * size) {
+    diverge_t *cur = NULL;
+    for(uint64_t r = r0; r < r1; r++) {
+        int pad_side;
+        bool mismatch;
+        if (!row_state(r, &pad_side, &mismatch)) {
+            continue;
+        }
+        // Extend the current region, or start a new one past the gap
+        if (cur == NULL || r >= cur->end + diverge_gap) {
+            if (*n == *size) {
+                *size *= 2;
+                *regions = realloc(*regions, sizeof(diverge_t) * *size);
+                assert(*regions);
+            }
+            cur = &(*regions)[(*n)++];
+            memset(cur, 0, sizeof(diverge_t));
+            cur->start = r;
+        }
+        cur->end = r + 1;
+        if (pad_side >= 0) {
+            cur->pad[pad_side] ++;
+            DIVERGE->pad[pad_side] ++;
+        }
+        if (mismatch) {
+            cur->mismatch ++;
+            DIVERGE->mismatch ++;
+        }
+    }
+}
+
+static uint64_t aligned_rows() {
+    return (TRACES[0]->n_insts > TRACES[1]->n_insts) ? TRACES[0]->n_insts : TRACES[1]->n_insts;
+}
+
+// Check if a row diverges. pad_side is set to the trace holding a dummy row,
+// or -1, and mismatch is set when both traces have differing instructions.
+static bool row_state(uint64_t r, int * pad_side, bool * mismatch) {
+    instruction_t *inst[2];
+    for(int t = 0; t < 2; t++) {
+        inst[t] = (r < TRACES[t]->n_insts && TRACES[t]->insts[r].valid) ? &TRACES[t]->insts[r] : NULL;
+    }
+    *pad_side = -1;
+    *mismatch = false;
+    if (inst[0] == NULL && inst[1] == NULL) {
+        return false;
+    }
+    if (inst[0] == NULL || inst[1] == NULL) {
+        *pad_side = (inst[0] == NULL) ? 0 : 1;
+        return true;
+    }
+    if (inst[0]->committed != inst[1]->committed) {
+        *mismatch = true;
+    } else if (inst[0]->committed && strcmp(inst[0]->pc_text, inst[1]->pc_text) != 0) {
+        *mismatch = true;
+    }
+    return *mismatch;
+}
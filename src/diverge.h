@@ -0,0 +1,69 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _DIVERGE_H_
+#define _DIVERGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dptv.h"
+
+// A run of aligned rows where the two traces disagree, either because one
+// side is padded with dummy rows or because the instructions on a row do not
+// match (different committed pc, or committed on one side only)
+typedef struct diverge_type {
+    uint64_t start;
+    uint64_t end;
+    uint64_t pad[2];
+    uint64_t mismatch;
+} diverge_t;
+
+// Divergence regions sorted by start row, plus totals over all rows
+typedef struct diverge_index_type {
+    diverge_t *regions;
+    uint64_t n;
+    uint64_t rows;
+    uint64_t pad[2];
+    uint64_t mismatch;
+} diverge_index_t;
+
+void build_diverge_index();
+void splice_diverge_index(uint64_t r0, uint64_t r1, uint64_t n_rows);
+void free_diverge_index();
+void dump_diverge_summary();
+int64_t diverge_find(uint64_t row, bool forward);
+
+extern diverge_index_t *DIVERGE;
+
+#endif
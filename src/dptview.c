@@ -43,6 +43,17 @@
 #include "gfx.h"
 #include "event.h"
 #include "search.h"
+#include "lod.h"
+#include "pool.h"
+#include "rowcache.h"
+#include "tiles.h"
+#include "sidebar.h"
+#include "textcache.h"
+#include "render.h"
+#include "minimap.h"
+#include "export.h"
+#include "perf.h"
+#include "bench.h"
 #include <stdbool.h>
 
 bool quit;
@@ -56,13 +67,51 @@ int main(int argc, char *argv[]) {
 
     init_traces();
     init_search();
+    init_perf(OPTIONS->frame_log);
     init_gfx();
+    // Caches every drawing thread keeps for itself, freed as each exits
+    pool_at_thread_exit(gfx_free_thread_caches);
+    pool_at_thread_exit(free_row_cache);
+    pool_at_thread_exit(free_search_cache);
+    init_pool(OPTIONS->threads - 1);
+    init_tiles((uint64_t)OPTIONS->tile_mem << 20);
+    init_side_rows(OPTIONS->side_rows);
+    if (OPTIONS->export_script != NULL) {
+        int failed = run_export(OPTIONS->export_script);
+        free_pool();
+        return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (OPTIONS->bench_passes > 0) {
+        run_bench_render(OPTIONS->bench_passes);
+        free_pool();
+        free_perf();
+        return EXIT_SUCCESS;
+    }
+    if (OPTIONS->glyph_bench) {
+        gfx_bench_glyphs();
+        free_pool();
+        return EXIT_SUCCESS;
+    }
+    build_minimap();
+    // Lay the window out again with the strip's column
+    gfx_win_refresh();
+    start_lod_build();
+    start_render_thread();
     
     while(!quit) {
         run_events();
-        gfx_update();
-        frame_limit();
+        if (!render_threaded()) {
+            gfx_update();
+            frame_limit();
+        }
     }
+    stop_render_thread();
+    stop_lod_build();
+    free_pool();
+    free_perf();
+    free_side_rows();
+    free_text_cache();
+    free_minimap();
 
     return EXIT_SUCCESS;
 }
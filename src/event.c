@@ -37,183 +37,336 @@
 #include "options.h"
 #include "gfx.h"
 #include "search.h"
+#include "perf.h"
+#include "render.h"
 #include <time.h>
 #include <sys/time.h>
 #include <unistd.h>
 
 
-static SDL_Event e;
+static SDL_Event polled;
 bool fast_move = false;
 int mx = 0;
 int my = 0;
 
-clock_t start, stop;
+// Longest time to block waiting for input while there is nothing to draw
+const int event_wait_ms = 500;
+// Minimum time between frames, when redrawing constantly
+const uint32_t frame_ms = 1000 / 120;
+// Input that changes more than the view, read while a frame is being drawn
+// and applied once it is done
+#define EVENT_QUEUE_LEN 256
+static SDL_Event queued[EVENT_QUEUE_LEN];
+static int n_queued = 0;
+uint32_t frame_start;
 bool first_frame = true;
 
+static bool is_view_event(SDL_Event * ev);
+static void queue_event(SDL_Event * ev);
+static void apply_queued();
+static void apply_event(SDL_Event * ev);
+
 
 void run_events() {
-    // Itterate through all occuring events
-    while(SDL_PollEvent(&e) != 0) {
-        SDL_Scancode code = e.key.keysym.scancode;
-        SDL_Keycode key = e.key.keysym.sym;
-        switch(e.type) {
-            // User requests quit
-            case(SDL_QUIT):
-                quit = true;
-                break;
-            // User does something with the mouse
-            case(SDL_MOUSEBUTTONDOWN):
-                if (e.button.button == SDL_BUTTON_LEFT) {
+    if (!render_threaded()) {
+        // Sleep until something happens if the window is up to date, drawing
+        // the tiles around the view in the meantime. They must be stopped
+        // before any event can change what they draw.
+        gfx_refine();
+        if (!gfx_is_dirty()) {
+            // Don't sleep past when a quickly drawn view is to be redrawn
+            int wait = gfx_refine_wait();
+            gfx_prefetch_tiles();
+            int woken = SDL_WaitEventTimeout(NULL, (wait >= 0 && wait < event_wait_ms) ? wait + 1 : event_wait_ms);
+            gfx_prefetch_finish();
+            if (woken == 0) {
+                gfx_refine();
+                return;
+            }
+        }
+    } else if (SDL_WaitEventTimeout(NULL, event_wait_ms) == 0) {
+        return;
+    }
+    // Take everything waiting. Moving the camera or search cursor is applied
+    // at once, unless it would overtake something already queued.
+    bool frame_done = false;
+    while(SDL_PollEvent(&polled) != 0) {
+        if (polled.type == SDL_MOUSEWHEEL) {
+            // One zoom step per event, however far the wheel turned
+            polled.wheel.y = (polled.wheel.y > 0) - (polled.wheel.y < 0);
+        }
+        if (polled.type == frame_ready_event) {
+            frame_done = true;
+        } else if (n_queued == 0 && is_view_event(&polled)) {
+            render_input_begin();
+            apply_event(&polled);
+            render_input_end();
+        } else {
+            queue_event(&polled);
+        }
+    }
+    // The rest after the frame being drawn if there is one, a finished frame
+    // is put on screen first
+    if (n_queued == 0 && !frame_done) {
+        return;
+    }
+    if (!render_acquire(frame_done)) {
+        return;
+    }
+    apply_queued();
+    render_release();
+}
+
+static bool is_view_event(SDL_Event * ev) {
+    // Whether the event only changes the camera or search cursor
+    switch(ev->type) {
+        case(SDL_MOUSEMOTION):
+        case(SDL_MOUSEWHEEL):
+        case(SDL_KEYUP):
+            return true;
+        case(SDL_MOUSEBUTTONDOWN):
+        case(SDL_MOUSEBUTTONUP):
+            // Clicking the overview strip moves the camera too
+            return true;
+        case(SDL_KEYDOWN): {
+            if (input_mode != INMODE_CAM) {
+                return false;
+            }
+            SDL_Scancode code = ev->key.keysym.scancode;
+            SDL_Keycode key = ev->key.keysym.sym;
+            return code == SDL_SCANCODE_LSHIFT || code == SDL_SCANCODE_RSHIFT ||
+                code == SDL_SCANCODE_W || code == SDL_SCANCODE_A || code == SDL_SCANCODE_S || code == SDL_SCANCODE_D ||
+                key == SDLK_UP || key == SDLK_DOWN || key == SDLK_LEFT || key == SDLK_RIGHT ||
+                code == SDL_SCANCODE_Z || code == SDL_SCANCODE_X || code == SDL_SCANCODE_G ||
+                code == SDL_SCANCODE_N || code == SDL_SCANCODE_P || code == SDL_SCANCODE_R;
+        }
+        default:
+            return false;
+    }
+}
+
+static void queue_event(SDL_Event * ev) {
+    // Only where the mouse ended up matters, wheel steps in a row add up, and
+    // key repeats that arrive while one is already waiting would only make
+    // the camera overshoot
+    if (ev->type == SDL_QUIT) {
+        quit = true;
+    }
+    if (n_queued > 0 && ev->type == SDL_MOUSEMOTION && queued[n_queued - 1].type == SDL_MOUSEMOTION) {
+        queued[n_queued - 1] = *ev;
+        return;
+    }
+    if (n_queued > 0 && ev->type == SDL_MOUSEWHEEL && queued[n_queued - 1].type == SDL_MOUSEWHEEL) {
+        queued[n_queued - 1].wheel.y += ev->wheel.y;
+        return;
+    }
+    if (ev->type == SDL_KEYDOWN && ev->key.repeat) {
+        for(int i = 0; i < n_queued; i++) {
+            if (queued[i].type == SDL_KEYDOWN && queued[i].key.keysym.scancode == ev->key.keysym.scancode) {
+                return;
+            }
+        }
+    }
+    if (n_queued == EVENT_QUEUE_LEN) {
+        // Full, wait for the frame being drawn rather than lose a key or
+        // button being let go
+        render_acquire(true);
+        apply_queued();
+        render_release();
+    }
+    queued[n_queued++] = *ev;
+}
+
+static void apply_queued() {
+    for(int i = 0; i < n_queued; i++) {
+        apply_event(&queued[i]);
+    }
+    n_queued = 0;
+}
+
+static void apply_event(SDL_Event * ev) {
+    SDL_Event e = *ev;
+    SDL_Scancode code = e.key.keysym.scancode;
+    SDL_Keycode key = e.key.keysym.sym;
+    switch(e.type) {
+        // User requests quit
+        case(SDL_QUIT):
+            quit = true;
+            break;
+        // User does something with the mouse
+        case(SDL_MOUSEBUTTONDOWN):
+            if (e.button.button == SDL_BUTTON_LEFT) {
+                if (gfx_minimap_hit(mx, my)) {
+                    gfx_minimap_jump(my);
+                } else {
                     gfx_begin_dragging(mx, my);
                 }
-                if (e.button.button == SDL_BUTTON_RIGHT) {
-                    gfx_snap_to_cycle(mx, my);
-                }
-                if (e.button.button == SDL_BUTTON_MIDDLE) {
+            }
+            if (e.button.button == SDL_BUTTON_RIGHT) {
+                gfx_snap_to_cycle(mx, my);
+            }
+            if (e.button.button == SDL_BUTTON_MIDDLE) {
+            }
+            break;
+        case(SDL_MOUSEMOTION):
+            mx = e.motion.x;
+            my = e.motion.y;
+            gfx_drag(mx, my);
+            break;
+        case(SDL_MOUSEBUTTONUP):
+            if (e.button.button == SDL_BUTTON_LEFT) {
+                gfx_end_dragging();
+            }
+            break;
+        case(SDL_WINDOWEVENT):
+            // User resizes window
+            if (e.window.event == SDL_WINDOWEVENT_RESIZED) {
+                gfx_win_resize(e.window.data1, e.window.data2);
+            } else if (e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                gfx_mark_dirty(DIRTY_ALL);
+            }
+            break;
+        // User presses keyboard button
+        case(SDL_KEYDOWN):
+            // Quit
+            if (input_mode != INMODE_SEARCH) {
+                if (code == SDL_SCANCODE_Q) {
+                    quit = true;
                 }
-                break;
-            case(SDL_MOUSEMOTION):
-                mx = e.motion.x;
-                my = e.motion.y;
-                gfx_drag(mx, my);
-                break;
-            case(SDL_MOUSEBUTTONUP):
-                if (e.button.button == SDL_BUTTON_LEFT) {
-                    gfx_end_dragging();
+            }
+            if (input_mode == INMODE_CAM) {
+                // Switch to other modes
+                if (code == SDL_SCANCODE_H) {
+                    toggle_help();
+                } else if (code == SDL_SCANCODE_SLASH) {
+                    search_input_begin(false);
+                    //SDL_StartTextInput();
+                } else if (code == SDL_SCANCODE_SEMICOLON) {
+                    search_input_begin(true);
+                } else if (code == SDL_SCANCODE_G) {
+                    if (fast_move) {
+                        gfx_move_to_last();
+                    } else {
+                        gfx_move_to_first();
+                    }
+                } else
+                // Other actions with keycodes
+                if (code == SDL_SCANCODE_N) {
+                    int64_t x = -1;
+                    int64_t y = search_find(fast_move ? false : true, &x);
+                    gfx_look_at(y, x);
+                } else if (code == SDL_SCANCODE_P) {
+                    gfx_snap();
+                    if (fast_move) {
+                        gfx_toggle_force_snap();
+                    }
+                } else if (code == SDL_SCANCODE_R) {
+                    gfx_reset();
+                } else if (code == SDL_SCANCODE_L) {
+                    instr_surf_width += 1;
+                    gfx_win_refresh();
+                } else if (code == SDL_SCANCODE_K) {
+                    instr_surf_width -= 1;
+                    gfx_win_refresh();
+                } else if (code == SDL_SCANCODE_M) {
+                    gfx_realign_local(mx, my);
+                } else if (code == SDL_SCANCODE_RIGHTBRACKET) {
+                    gfx_jump_divergence(true);
+                } else if (code == SDL_SCANCODE_LEFTBRACKET) {
+                    gfx_jump_divergence(false);
+                } else if (code == SDL_SCANCODE_F) {
+                    perf_toggle_hud();
+                    setup_cmd();
+                } else if (code == SDL_SCANCODE_O) {
+                    gfx_cycle_minimap();
+                } else
+                // Move camera (scancode/keycode)
+                if (code == SDL_SCANCODE_LSHIFT || code == SDL_SCANCODE_RSHIFT) {
+                    fast_move = true;
+                } else if (code == SDL_SCANCODE_W || key == SDLK_UP) {
+                    gfx_move(0, -1, fast_move);
+                } else if (code == SDL_SCANCODE_S || key == SDLK_DOWN) {
+                    gfx_move(0, 1, fast_move);
+                } else if (code == SDL_SCANCODE_D || key == SDLK_RIGHT) {
+                    gfx_move(1, 0, fast_move);
+                } else if (code == SDL_SCANCODE_A || key == SDLK_LEFT) {
+                    gfx_move(-1, 0, fast_move);
                 }
-            case(SDL_WINDOWEVENT):
-                // User resizes window
-                if (e.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    gfx_win_resize(e.window.data1, e.window.data2);
+                // Shift second trace cycle offset
+                if (code == SDL_SCANCODE_Z) {
+                    gfx_shift_trace(-1, fast_move);
+                } else if (code == SDL_SCANCODE_X) {
+                    gfx_shift_trace(1, fast_move);
                 }
-                break;
-            // User presses keyboard button
-            case(SDL_KEYDOWN):
-                // Quit
-                if (input_mode != INMODE_SEARCH) {
-                    if (code == SDL_SCANCODE_Q) {
-                        quit = true;
-                    }
+                // Cancel search
+                if (key == SDLK_ESCAPE) {
+                    search_end();
                 }
-                if (input_mode == INMODE_CAM) {
-                    // Switch to other modes
-                    if (code == SDL_SCANCODE_H) {
-                        toggle_help();
-                    } else if (code == SDL_SCANCODE_SLASH) {
-                        search_input_begin(false);
-                        //SDL_StartTextInput();
-                    } else if (code == SDL_SCANCODE_SEMICOLON) {
-                        search_input_begin(true);
-                    } else if (code == SDL_SCANCODE_G) {
-                        if (fast_move) {
-                            gfx_move_to_last();
-                        } else {
-                            gfx_move_to_first();
-                        }
-                    } else
-                    // Other actions with keycodes
-                    if (code == SDL_SCANCODE_N) {
-                        int64_t x = -1;
-                        int64_t y = search_find(fast_move ? false : true, &x);
-                        gfx_look_at(y, x);
-                    } else if (code == SDL_SCANCODE_P) {
-                        gfx_snap();
-                        if (fast_move) {
-                            gfx_toggle_force_snap();
-                        }
-                    } else if (code == SDL_SCANCODE_R) {
-                        gfx_reset();
-                    } else if (code == SDL_SCANCODE_L) {
-                        instr_surf_width += 1;
-                        gfx_win_refresh();
-                    } else if (code == SDL_SCANCODE_K) {
-                        instr_surf_width -= 1;
-                        gfx_win_refresh();
-                    } else
-                    // Move camera (scancode/keycode)
-                    if (code == SDL_SCANCODE_LSHIFT || code == SDL_SCANCODE_RSHIFT) {
-                        fast_move = true;
-                    } else if (code == SDL_SCANCODE_W || key == SDLK_UP) {
-                        gfx_move(0, -1, fast_move);
-                    } else if (code == SDL_SCANCODE_S || key == SDLK_DOWN) {
-                        gfx_move(0, 1, fast_move);
-                    } else if (code == SDL_SCANCODE_D || key == SDLK_RIGHT) {
-                        gfx_move(1, 0, fast_move);
-                    } else if (code == SDL_SCANCODE_A || key == SDLK_LEFT) {
-                        gfx_move(-1, 0, fast_move);
-                    }
-                    // Shift second trace cycle offset
-                    if (code == SDL_SCANCODE_Z) {
-                        gfx_shift_trace(-1, fast_move);
-                    } else if (code == SDL_SCANCODE_X) {
-                        gfx_shift_trace(1, fast_move);
-                    }
-                    // Cancel search
-                    if (key == SDLK_ESCAPE) {
-                        search_end();
-                    }
-                } else if (input_mode == INMODE_HELP) {
-                    // Help menu navigation
-                    if (code == SDL_SCANCODE_D || key == SDLK_RIGHT) {
-                        gfx_help_page_inc();
-                    } else if (code == SDL_SCANCODE_A || key == SDLK_LEFT) {
-                        gfx_help_page_dec();
-                    } else if (code == SDL_SCANCODE_H || key == SDLK_ESCAPE) {
-                        toggle_help();
-                    }
-                } else if (input_mode == INMODE_SEARCH) {
-                    // Searching
-                    if (key == SDLK_ESCAPE) {
-                        search_input_abort();
-                        //SDL_StopTextInput();
-                    } else if (key == SDLK_KP_ENTER || key == SDLK_RETURN || key == SDLK_RETURN2) {
-                        search_input_finish();
-                        //SDL_StopTextInput();
-                    } else if (key == SDLK_BACKSPACE) {
-                        search_input_key(0);
-                    }
+            } else if (input_mode == INMODE_HELP) {
+                // Help menu navigation
+                if (code == SDL_SCANCODE_D || key == SDLK_RIGHT) {
+                    gfx_help_page_inc();
+                } else if (code == SDL_SCANCODE_A || key == SDLK_LEFT) {
+                    gfx_help_page_dec();
+                } else if (code == SDL_SCANCODE_H || key == SDLK_ESCAPE) {
+                    toggle_help();
                 }
-                break;
-            case(SDL_TEXTINPUT):
-                // Text input, used in searching
-                if (input_mode == INMODE_SEARCH) {
-                    search_input_key(e.text.text[0]);
+            } else if (input_mode == INMODE_SEARCH) {
+                // Searching
+                if (key == SDLK_ESCAPE) {
+                    search_input_abort();
+                    //SDL_StopTextInput();
+                } else if (key == SDLK_KP_ENTER || key == SDLK_RETURN || key == SDLK_RETURN2) {
+                    search_input_finish();
+                    //SDL_StopTextInput();
+                } else if (key == SDLK_BACKSPACE) {
+                    search_input_key(0);
                 }
-                break;
-            case(SDL_KEYUP):
-                if (code == SDL_SCANCODE_P) {
-                    //gfx_snap_off();
-                } else if (code == SDL_SCANCODE_LSHIFT || code == SDL_SCANCODE_RSHIFT) {
-                    fast_move = false;
+            }
+            break;
+        case(SDL_TEXTINPUT):
+            // Text input, used in searching
+            if (input_mode == INMODE_SEARCH) {
+                search_input_key(e.text.text[0]);
+            }
+            break;
+        case(SDL_KEYUP):
+            if (code == SDL_SCANCODE_P) {
+                //gfx_snap_off();
+            } else if (code == SDL_SCANCODE_LSHIFT || code == SDL_SCANCODE_RSHIFT) {
+                fast_move = false;
+            }
+            break;
+        case(SDL_MOUSEWHEEL):
+            if (input_mode == INMODE_CAM) {
+                // Queued steps in a row are added up
+                for(int i = 0; i > e.wheel.y; i--) {
+                    gfx_inc_scale(mx, my);
                 }
-                break;
-            case(SDL_MOUSEWHEEL):
-                if (input_mode == INMODE_CAM) {
-                    if (e.wheel.y < 0) {
-                        gfx_inc_scale(mx, my);
-                    } else if (e.wheel.y > 0) {
-                        gfx_dec_scale(mx, my);
-                    }
+                for(int i = 0; i < e.wheel.y; i++) {
+                    gfx_dec_scale(mx, my);
                 }
-                break;
-            default:
-                break;
-        }
+            }
+            break;
+        default:
+            // Background pyramid build finished, redraw from it
+            if (e.type == lod_ready_event) {
+                gfx_invalidate_view();
+            }
+            break;
     }
-
 }
 
 void frame_limit() {
     
     // Get how long to sleep
     if (!first_frame) {
-        stop = clock();
-        double exec_time = (stop - start);
-        double sleep_time = (1/120 - exec_time);
-        if (sleep_time > 0) {
-            sleep(sleep_time);
+        uint32_t exec_time = SDL_GetTicks() - frame_start;
+        if (exec_time < frame_ms) {
+            SDL_Delay(frame_ms - exec_time);
         }
     }
-    start = clock();
+    first_frame = false;
+    frame_start = SDL_GetTicks();
     
 }
@@ -0,0 +1,228 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <libdeflate.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "dptv.h"
+#include "options.h"
+#include "gfx.h"
+#include "lod.h"
+#include "export.h"
+
+// Largest image side drawn for one viewport, in pixels
+static const int export_max_side = 16384;
+
+static uint8_t * export_rgb(SDL_Surface *);
+static void png_chunk(FILE *, const char *, const uint8_t *, uint32_t);
+static void put_be32(uint8_t *, uint32_t);
+
+// Draw each viewport listed in a script to an image file, without a window.
+// Each line of the script is
+//     <file> <first inst> <last inst> <first cycle> <last cycle> <zoom> [<offset>]
+// where the cycles are of the main trace, the offset is the cycle offset of
+// the other trace, and the file is written as PNG unless it ends in .ppm.
+// Blank lines and lines starting with # are skipped. Returns the number of
+// viewports that failed.
+int run_export(const char * script) {
+    FILE *f = (strcmp(script, "-") == 0) ? stdin : fopen(script, "r");
+    if (f == NULL) {
+        fprintf(stderr, "export: failed to open %s\n", script);
+        return 1;
+    }
+    // Far zoomed out views are drawn from the pyramid, so wait for it
+    start_lod_build();
+    wait_lod_build();
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    int n_done = 0;
+    int n_failed = 0;
+    char line[2048];
+    char path[1024];
+    for(int line_num = 1; fgets(line, sizeof(line), f) != NULL; line_num++) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') {
+            continue;
+        }
+        uint64_t inst_0, inst_1;
+        double cycle_0, cycle_1, zoom;
+        int off = 0;
+        int n = sscanf(p, "%1023s %"SCNu64" %"SCNu64" %lf %lf %lf %d", path, &inst_0, &inst_1, &cycle_0, &cycle_1, &zoom, &off);
+        if (n < 6 || inst_1 < inst_0 || cycle_1 < cycle_0 || zoom <= 0) {
+            fprintf(stderr, "export: %s:%d: expected <file> <first inst> <last inst> <first cycle> <last cycle> <zoom> [<offset>]\n", script, line_num);
+            n_failed ++;
+            continue;
+        }
+        SDL_Surface *surf = gfx_render_viewport(inst_0, inst_1, cycle_0, cycle_1, zoom, off, export_max_side);
+        if (surf == NULL) {
+            fprintf(stderr, "export: %s:%d: viewport is larger than %d pixels on a side\n", script, line_num, export_max_side);
+            n_failed ++;
+            continue;
+        }
+        size_t len = strlen(path);
+        bool ppm = len > 4 && strcmp(path + len - 4, ".ppm") == 0;
+        bool ok = ppm ? export_write_ppm(surf, path) : export_write_png(surf, path);
+        if (!ok) {
+            fprintf(stderr, "export: failed to write %s\n", path);
+            n_failed ++;
+            continue;
+        }
+        n_done ++;
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+    double secs = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("export: wrote %d images in %.2f s", n_done, secs);
+    if (n_failed > 0) {
+        printf(", %d failed", n_failed);
+    }
+    printf("\n");
+    stop_lod_build();
+    return n_failed;
+}
+
+// Packed 8 bit RGB copy of a surface's pixels
+static uint8_t * export_rgb(SDL_Surface * surf) {
+    uint8_t *rgb = malloc((size_t)surf->w * surf->h * 3);
+    if (rgb == NULL) {
+        return NULL;
+    }
+    uint8_t *out = rgb;
+    for(int y = 0; y < surf->h; y++) {
+        uint32_t *row = (uint32_t *)((uint8_t *)surf->pixels + y * surf->pitch);
+        for(int x = 0; x < surf->w; x++) {
+            SDL_GetRGB(row[x], surf->format, &out[0], &out[1], &out[2]);
+            out += 3;
+        }
+    }
+    return rgb;
+}
+
+bool export_write_ppm(SDL_Surface * surf, const char * path) {
+    uint8_t *rgb = export_rgb(surf);
+    FILE *f = fopen(path, "wb");
+    if (rgb == NULL || f == NULL) {
+        free(rgb);
+        if (f != NULL) fclose(f);
+        return false;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", surf->w, surf->h);
+    size_t n = (size_t)surf->w * surf->h * 3;
+    bool ok = fwrite(rgb, 1, n, f) == n;
+    free(rgb);
+    return (fclose(f) == 0) && ok;
+}
+
+static void put_be32(uint8_t * p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// Write one chunk: length, type, data, and the CRC of type and data
+static void png_chunk(FILE * f, const char * type, const uint8_t * data, uint32_t len) {
+    uint8_t buf[4];
+    put_be32(buf, len);
+    fwrite(buf, 1, 4, f);
+    fwrite(type, 1, 4, f);
+    uint32_t crc = libdeflate_crc32(0, type, 4);
+    if (len > 0) {
+        fwrite(data, 1, len, f);
+        crc = libdeflate_crc32(crc, data, len);
+    }
+    put_be32(buf, crc);
+    fwrite(buf, 1, 4, f);
+}
+
+// 8 bit RGB PNG, with the Sub filter on every row, which suits the long runs
+// of one color in a pipeline diagram
+bool export_write_png(SDL_Surface * surf, const char * path) {
+    uint8_t *rgb = export_rgb(surf);
+    if (rgb == NULL) {
+        return false;
+    }
+    size_t stride = (size_t)surf->w * 3;
+    size_t raw_len = (stride + 1) * surf->h;
+    uint8_t *raw = malloc(raw_len);
+    struct libdeflate_compressor *comp = libdeflate_alloc_compressor(6);
+    size_t bound = libdeflate_zlib_compress_bound(comp, raw_len);
+    uint8_t *packed = malloc(bound);
+    FILE *f = fopen(path, "wb");
+    bool ok = raw != NULL && comp != NULL && packed != NULL && f != NULL;
+    if (ok) {
+        for(int y = 0; y < surf->h; y++) {
+            uint8_t *src = rgb + y * stride;
+            uint8_t *dst = raw + y * (stride + 1);
+            dst[0] = 1;
+            memcpy(dst + 1, src, 3);
+            for(size_t x = 3; x < stride; x++) {
+                dst[x + 1] = src[x] - src[x - 3];
+            }
+        }
+        size_t packed_len = libdeflate_zlib_compress(comp, raw, raw_len, packed, bound);
+        ok = packed_len > 0;
+        if (ok) {
+            static const uint8_t sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+            uint8_t ihdr[13];
+            put_be32(ihdr, surf->w);
+            put_be32(ihdr + 4, surf->h);
+            ihdr[8] = 8;        // bits per channel
+            ihdr[9] = 2;        // RGB
+            ihdr[10] = 0;       // deflate
+            ihdr[11] = 0;       // adaptive filtering
+            ihdr[12] = 0;       // not interlaced
+            fwrite(sig, 1, 8, f);
+            png_chunk(f, "IHDR", ihdr, 13);
+            png_chunk(f, "IDAT", packed, packed_len);
+            png_chunk(f, "IEND", NULL, 0);
+            ok = !ferror(f);
+        }
+    }
+    if (f != NULL && fclose(f) != 0) {
+        ok = false;
+    }
+    if (comp != NULL) {
+        libdeflate_free_compressor(comp);
+    }
+    free(packed);
+    free(raw);
+    free(rgb);
+    return ok;
+}
@@ -37,6 +37,7 @@
 #include "options.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <assert.h>
 #include <SDL2/SDL_ttf.h>
 #include "trace_handler.h"
 #include "gfx.h"
@@ -44,6 +45,17 @@
 #include "search.h"
 #include "options.h"
 #include "help_text.h"
+#include "warp.h"
+#include "diverge.h"
+#include "glyph.h"
+#include "rowcache.h"
+#include "pool.h"
+#include "tiles.h"
+#include "sidebar.h"
+#include "textcache.h"
+#include "render.h"
+#include "minimap.h"
+#include "perf.h"
 
 
 
@@ -53,29 +65,131 @@
 SDL_Window *window = NULL;
 SDL_Surface *screen_surface = NULL;
 SDL_Renderer *stage_render = NULL;
+SDL_Renderer *instr_render = NULL;
+glyph_batch_t *stage_glyphs = NULL;
+glyph_batch_t *instr_glyphs = NULL;
+// Glyph sets pre-scaled for the current zoom, one per character size in use
+#define GFX_GLYPH_SETS 8
+glyph_set_t *glyph_sets[GFX_GLYPH_SETS];
+int num_glyph_sets = 0;
+const int max_glyph_set_h = 256;
+// Bumped when the character surfaces or glyph sets are rebuilt, and when the
+// drawing surfaces are remade, so band resources know to follow
+uint64_t glyph_gen = 1;
+uint64_t surf_gen = 1;
+// Tall redraws are split into bands of at least this many pixel rows, each
+// drawn on its own thread
+const int min_band_h = 32;
 int gfx_win_height;
 int gfx_win_width;
 TTF_Font* cp_mono;
 SDL_Rect font_size;
-int64_t x_pos = 0;
-int64_t y_pos = 0;
-double scale = 0.75;
+// Camera, what needs redrawing, and the pointer for the hover box. The event
+// thread changes input_view while frames are drawn from frame_view, a copy
+// taken as each starts, so input is applied as it arrives and a frame never
+// sees it half done. Without a render thread they are the same view.
+struct gfx_view {
+    int64_t x_pos;
+    int64_t y_pos;
+    double scale;
+    int trace_off;
+    int dirty;
+    // While zooming or dragging, stages are drawn as blocks of color and
+    // drawn properly once input has been still for OPTIONS->refine_ms
+    bool interacting;
+    uint32_t interact_ticks;
+    int mx;
+    int my;
+} typedef gfx_view_t;
+gfx_view_t frame_view = {0, 0, 0.75, 0, DIRTY_ALL, false, 0, 0, 0};
+gfx_view_t* input_view = &frame_view;
+// The view this thread reads and changes, input_view on the event thread
+_Thread_local gfx_view_t* cam = &frame_view;
+// Zoom the glyph sets were last built for
+double glyph_scale = 0;
 const double line_cutoff = 0.2;
 const double draw_instr_cutoff = 0.2;
 const int line_draw_precision = 1;
+const uint64_t realign_radius = 512;
+const uint64_t diverge_context = 4;
+// Shades of a trace's color used for pipeline occupancy when zoomed far out
+#define LOD_SHADES 8
+char diverge_text[96] = "";
 bool info_on = true;
 int info_width = 32;
 int info_height = 32;
 uint64_t x_check = 0;
 uint64_t y_check = 0;
+// Stage the info panel was last drawn for, it is redrawn when the hover moves
+// to another stage or what it shows changes
+uint64_t info_x = 0;
+uint64_t info_y = 0;
+bool info_stale = true;
 line_sec_t* gfx_lines;
 int num_lines = 0;
+// Decimated line mode strips of each trace, rebuilt when the zoom changes or
+// the view leaves the rows they cover. Each drawing thread keeps its own.
+_Thread_local line_cache_t* line_caches = NULL;
+// Bumped whenever the rows of the traces are rearranged, so that anything
+// cached by row is rebuilt
+uint64_t align_gen = 0;
 bool first = true;
+// Window areas covered by the hover box and info panel in the last frame
+SDL_Rect hover_rect = {0, 0, 0, 0};
+SDL_Rect info_rect = {0, 0, 0, 0};
+// Areas of the last frame still to be put on screen
+SDL_Rect present_damage[GFX_MAX_DAMAGE];
+int n_present = 0;
+uint64_t present_frame_start = 0;
+gfx_color_t hover_color;
+// Camera position in pixels when the stage surface was last drawn, and the
+// area of it being drawn now
+int64_t drawn_cam_x = 0;
+int64_t drawn_cam_y = 0;
+_Thread_local SDL_Rect draw_area;
+_Thread_local bool draw_sidebar = true;
+// The last frame was drawn in blocks, the view is redrawn once input settles
+bool coarse_drawn = false;
+bool draw_coarse = false;
+// Surfaces and renderer the drawing functions write to. These are the real
+// ones on the main thread, or a band's views of them in a parallel redraw.
+_Thread_local SDL_Surface* draw_stage = NULL;
+_Thread_local SDL_Surface* draw_instr = NULL;
+_Thread_local SDL_Renderer* draw_render = NULL;
+// World pixel drawn at the top left of those, the camera unless drawing a tile
+_Thread_local int64_t draw_org_x = 0;
+_Thread_local int64_t draw_org_y = 0;
+// Drawing resources of one thread taking part in parallel redraws. SDL blits
+// change state held on the source surface, so each thread draws with its own
+// copies of the glyphs, and renders through its own views of the surfaces.
+struct gfx_band {
+    uint64_t surf_gen;
+    SDL_Surface* stage;
+    SDL_Surface* instr;
+    SDL_Renderer* render;
+    uint64_t glyph_gen;
+    SDL_Surface* chars['~' - ' ' + 1];
+    glyph_set_t* sets[GFX_GLYPH_SETS];
+    int num_sets;
+} typedef gfx_band_t;
+_Thread_local gfx_band_t* band_res = NULL;
+// Tiles being drawn ahead on the workers while the main thread waits
+tile_t** prefetch = NULL;
+int n_prefetch = 0;
+// Set while this thread is drawing a band
+_Thread_local gfx_band_t* band = NULL;
+// Area of a parallel redraw and how it is split
+struct gfx_band_job {
+    SDL_Rect area;
+    bool sidebar;
+    int n_bands;
+    int64_t org_x;
+    int64_t org_y;
+} typedef gfx_band_job_t;
 bool help = false;
 int input_mode = INMODE_CAM;
 bool force_snap = false;
 int focus = 0;
-int trace_off;
 SDL_Surface** char_surfaces;
 double txt_base_scale = 0.5;
 bool is_dragging;
@@ -111,10 +225,17 @@ SDL_Surface* stage_surf = NULL;
 SDL_Surface* info_surf = NULL;
 SDL_Surface* cmd_surf = NULL;
 SDL_Surface* help_surf = NULL;
+SDL_Surface* minimap_surf = NULL;
 
 const int default_instr_surf_width = 512-64;
 int instr_surf_width;
 const int cmd_surf_height = 32;
+// Overview strip in its own column between the sidebar and the stage area,
+// hidden in the last mode
+const int minimap_width = 24;
+int minimap_mode = MINIMAP_IPC;
+// Left edge of the stage area in the window
+int stage_surf_x;
 
 
 /*
@@ -123,7 +244,8 @@ const int cmd_surf_height = 32;
 
 void init_gfx() {
     printf("initializing gfx system...");
-    if (SDL_Init(SDL_INIT_VIDEO) < 0){
+    // Headless runs draw into plain surfaces, with no video system at all
+    if (SDL_Init(OPTIONS->headless ? 0 : SDL_INIT_VIDEO) < 0){
         fprintf(stderr,"ERROR: failed to initialize video. %s\n",SDL_GetError());
         exit(EXIT_FAILURE);
     }
@@ -137,10 +259,12 @@ void init_gfx() {
     gfx_win_height = OPTIONS->win_height;
     gfx_win_width = OPTIONS->win_width;
     
-    window = SDL_CreateWindow(OPTIONS->win_title, OPTIONS->win_xpos, OPTIONS->win_ypos, OPTIONS->win_width, OPTIONS->win_height, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (!window) {
-        fprintf(stderr,"ERROR: failed to create window. %s\n",SDL_GetError());
-        exit(EXIT_FAILURE);
+    if (!OPTIONS->headless) {
+        window = SDL_CreateWindow(OPTIONS->win_title, OPTIONS->win_xpos, OPTIONS->win_ypos, OPTIONS->win_width, OPTIONS->win_height, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+        if (!window) {
+            fprintf(stderr,"ERROR: failed to create window. %s\n",SDL_GetError());
+            exit(EXIT_FAILURE);
+        }
     }
     
     // Initialize text renderer
@@ -155,7 +279,11 @@ void init_gfx() {
     }
     font_size = gfx_get_font_size();
         
-    screen_surface = SDL_GetWindowSurface(window);
+    if (window != NULL) {
+        screen_surface = SDL_GetWindowSurface(window);
+    } else {
+        screen_surface = SDL_CreateRGBSurface(0, OPTIONS->win_width, OPTIONS->win_height, 32, 0, 0, 0, 0);
+    }
     // Setup colors
     gfx_setup_int_color(screen_surface, &COLORS->bg);
     gfx_setup_int_color(screen_surface, &COLORS->ui);
@@ -185,7 +313,9 @@ void init_gfx() {
     }
     
     // Generate surfaces containing characters
+    init_glyph_blend();
     gfx_gen_char_surfs();
+    make_glyph_batches();
     
     gfx_reset();
     
@@ -193,67 +323,851 @@ void init_gfx() {
     
     printf("GFX Initialized\n");
     
-    SDL_StartTextInput();
+    if (window != NULL) {
+        SDL_StartTextInput();
+    }
 }
 
 void gfx_reset() {
-    y_pos = 0;
-    scale = 0.75;
+    cam->y_pos = 0;
+    cam->scale = 0.75;
+    gfx_mark_dirty(DIRTY_VIEW);
     // Snap at start
     gfx_snap();
-    gfx_snap_to_cycle(instr_surf_width, 0);
+    gfx_snap_to_cycle(stage_surf_x, 0);
 }
 
 
+void gfx_use_input_view() {
+    // Called on the event thread as a render thread starts, input is then
+    // kept apart from the view being drawn
+    static gfx_view_t view;
+    view = frame_view;
+    input_view = &view;
+    cam = input_view;
+}
+
+void gfx_take_view() {
+    // Start a frame from the camera and search as input has left them. With
+    // a render thread this is called holding the lock input is applied under.
+    if (input_view != &frame_view) {
+        frame_view = *input_view;
+        input_view->dirty = 0;
+    }
+    frame_view.mx = mx;
+    frame_view.my = my;
+    search_take_cursor();
+}
+
 void gfx_update() {
-    // Fill Rectangle
-    SDL_FillRect(screen_surface, NULL, COLORS->ui.int_color);
-    SDL_FillRect(instr_surf, NULL, COLORS->bg.int_color);
-    SDL_FillRect(stage_surf, NULL, COLORS->bg.int_color);
-    
-    // Get stage checked
-    cycle_pos_t cycle = gfx_get_mouse_stage_position(mx, my);
+    if (!render_threaded()) {
+        gfx_take_view();
+    }
+    // Glyphs are scaled here rather than as the zoom changes, so they don't
+    // change under a frame being drawn
+    if (cam->scale != glyph_scale) {
+        gfx_rescale_glyphs();
+    }
+    if (cam->dirty & DIRTY_CMD) {
+        gfx_draw_cmd();
+    }
+    // Get stage checked, moving the hover box only needs a partial redraw
+    cycle_pos_t cycle = gfx_get_mouse_stage_position(cam->mx, cam->my);
+    if (cycle.x != x_check || cycle.y != y_check) {
+        cam->dirty |= DIRTY_HOVER;
+    }
+    if (cam->dirty == 0) {
+        return;
+    }
+    uint64_t frame_start = perf_now();
     x_check = cycle.x;      y_check = cycle.y;
+    if (perf_hud_on()) {
+        gfx_draw_perf_hud();
+    }
     
+    // Areas of the window to recompose and push to the screen
+    SDL_Rect damage[GFX_MAX_DAMAGE];
+    int n_damage = 0;
+    bool full = (cam->dirty & (DIRTY_VIEW | DIRTY_SCROLL | DIRTY_HELP)) != 0;
+    if (full) {
+        gfx_add_damage(damage, &n_damage, (SDL_Rect){0, 0, screen_surface->w, screen_surface->h});
+    }
+    
+    if (cam->dirty & (DIRTY_VIEW | DIRTY_SCROLL)) {
+        uint64_t start = perf_now();
+        gfx_draw_view((cam->dirty & DIRTY_VIEW) != 0);
+        perf_add(PERF_VIEW, start);
+    }
+    
+    if (cam->dirty & (DIRTY_VIEW | DIRTY_SCROLL | DIRTY_HOVER)) {
+        // The old hover box and info panel are covered by recomposing
+        // whatever was under them
+        if (!full) {
+            gfx_add_damage(damage, &n_damage, hover_rect);
+            gfx_add_damage(damage, &n_damage, info_rect);
+        }
+        // Setup info surface
+        if (info_stale || x_check != info_x || y_check != info_y) {
+            uint64_t start = perf_now();
+            setup_info(COLORS->ui);
+            perf_add(PERF_INFO, start);
+            info_x = x_check;   info_y = y_check;
+            info_stale = false;
+        }
+        hover_rect = gfx_get_stage_box_rect(cycle);
+        info_rect = (SDL_Rect){0, 0, 0, 0};
+        if (info_on) {
+            info_rect = (SDL_Rect){screen_surface->w - info_width - 4, 0, info_width + 4, info_height + 4};
+        }
+        if (!full) {
+            gfx_add_damage(damage, &n_damage, hover_rect);
+            gfx_add_damage(damage, &n_damage, info_rect);
+        }
+    }
+    if ((cam->dirty & DIRTY_CMD) && !full) {
+        gfx_add_damage(damage, &n_damage, (SDL_Rect){0, screen_surface->h - cmd_surf->h, cmd_surf->w, cmd_surf->h});
+    }
+    
+    // Color of the box for the selected stage
+    hover_color = COLORS->trace_b;
+    if (cycle.y % OPTIONS->num_traces == focus) {
+        hover_color = COLORS->trace_a;
+    }
+    
+    // Combine surfaces in each damaged area
+    uint64_t start = perf_now();
+    for(int i = 0; i < n_damage; i++) {
+        gfx_compose(&damage[i]);
+    }
+    perf_add(PERF_COMPOSE, start);
+    
+    // With a render thread the event thread puts it on screen
+    memcpy(present_damage, damage, sizeof(SDL_Rect) * n_damage);
+    n_present = n_damage;
+    present_frame_start = frame_start;
+    if (!render_threaded()) {
+        gfx_present();
+    }
+
+    cam->dirty = 0;
+    first = false;
+    
+}
+
+void gfx_present() {
+    // Push the areas composed by the last gfx_update to the window
+    uint64_t start = perf_now();
+    if (window != NULL && n_present > 0) {
+        SDL_UpdateWindowSurfaceRects(window, present_damage, n_present);
+    }
+    perf_add(PERF_PRESENT, start);
+    perf_add(PERF_TOTAL, present_frame_start);
+    perf_end_frame();
+    n_present = 0;
+}
+
+void gfx_draw_view(bool redraw) {
+    // Pixel position of the camera. Positions are anchored to the world, so a
+    // scroll moves every row and cell by the same whole number of pixels.
+    int64_t cam_x = floor(cam->x_pos * font_size.w * cam->scale);
+    int64_t cam_y = floor(cam->y_pos * font_size.h * cam->scale);
+    int64_t dx = cam_x - drawn_cam_x;
+    int64_t dy = cam_y - drawn_cam_y;
+    side_new_frame();
+    drawn_cam_x = cam_x;
+    drawn_cam_y = cam_y;
+    int w = stage_surf->w;
+    int h = stage_surf->h;
+    // Blocks aren't kept in the tiles, the refining pass draws over them all
+    draw_coarse = cam->interacting;
+    if (draw_coarse) {
+        coarse_drawn = true;
+    }
+    if (tiles_enabled() && stage_glyphs == NULL && !draw_coarse) {
+        gfx_draw_tiles(cam_x, cam_y);
+        // The sidebar isn't tiled, scroll it as below
+        if (redraw || llabs(dy) >= h) {
+            gfx_draw_area((SDL_Rect){0, 0, 0, h}, true);
+        } else {
+            gfx_scroll_surface(instr_surf, 0, -dy);
+            if (dy > 0) {
+                gfx_draw_area((SDL_Rect){0, h - dy, 0, dy}, true);
+            } else if (dy < 0) {
+                gfx_draw_area((SDL_Rect){0, 0, 0, -dy}, true);
+            }
+        }
+        return;
+    }
+    if (redraw || llabs(dx) >= w || llabs(dy) >= h) {
+        gfx_draw_area((SDL_Rect){0, 0, w, h}, true);
+        return;
+    }
+    // Reuse the last frame shifted by the scroll, and draw what it uncovers
+    gfx_scroll_surface(stage_surf, -dx, -dy);
+    gfx_scroll_surface(instr_surf, 0, -dy);
+    if (dy > 0) {
+        gfx_draw_area((SDL_Rect){0, h - dy, w, dy}, true);
+    } else if (dy < 0) {
+        gfx_draw_area((SDL_Rect){0, 0, w, -dy}, true);
+    }
+    if (dx > 0) {
+        gfx_draw_area((SDL_Rect){w - dx, 0, dx, h}, false);
+    } else if (dx < 0) {
+        gfx_draw_area((SDL_Rect){0, 0, -dx, h}, false);
+    }
+}
+
+SDL_Surface* gfx_render_viewport(uint64_t inst_0, uint64_t inst_1, double cycle_0, double cycle_1, double zoom, int off, int max_side) {
+    // Draw the stage area for the given instructions and cycles of the main
+    // trace at a zoom, sizing the stage surface to fit. Returns it, or NULL
+    // if it would be too big.
+    double w = ceil((cycle_1 - cycle_0 + 1) * OPTIONS->scale[focus] * font_size.w * zoom);
+    double h = ceil((inst_1 - inst_0 + 1) * OPTIONS->num_traces * font_size.h * zoom);
+    if (w > max_side || h > max_side) {
+        return NULL;
+    }
+    if (stage_surf->w != (int)w || stage_surf->h != (int)h) {
+        gfx_win_resize(stage_surf_x + (int)w, (int)h);
+    }
+    cam->trace_off = off;
+    if (zoom != cam->scale) {
+        cam->scale = zoom;
+        gfx_rescale_glyphs();
+    }
+    cam->y_pos = inst_0 * OPTIONS->num_traces;
+    cam->x_pos = floor(gfx_cycle_to_world(focus, cycle_0));
+    // Highlight the search hit the script left current
+    search_take_cursor();
+    gfx_draw_area((SDL_Rect){0, 0, stage_surf->w, stage_surf->h}, false);
+    cam->dirty = 0;
+    return stage_surf;
+}
+
+void gfx_draw_area(SDL_Rect area, bool sidebar) {
+    // Redraw the part of the stage surface inside area, and if asked the same
+    // rows of the instruction sidebar. Tall areas are split into bands of
+    // rows drawn on the worker pool, unless characters go through the atlas
+    // batches which only the main thread can use.
+    draw_org_x = floor(cam->x_pos * font_size.w * cam->scale);
+    draw_org_y = floor(cam->y_pos * font_size.h * cam->scale);
+    int n_bands = area.h / min_band_h;
+    if (n_bands > pool_threads() + 1) {
+        n_bands = pool_threads() + 1;
+    }
+    if (n_bands < 2 || stage_glyphs != NULL) {
+        draw_stage = stage_surf;
+        draw_instr = instr_surf;
+        draw_render = stage_render;
+        gfx_draw_band(area, sidebar);
+        return;
+    }
+    gfx_band_job_t job = {area, sidebar, n_bands, draw_org_x, draw_org_y};
+    pool_for(gfx_draw_band_job, &job, n_bands);
+}
+
+gfx_band_t* gfx_get_band() {
+    // This thread's band resources, remade if the surfaces or glyphs have
+    // changed since it last drew
+    if (band_res == NULL) {
+        band_res = calloc(1, sizeof(gfx_band_t));
+    }
+    gfx_band_t* b = band_res;
+    if (b->surf_gen != surf_gen) {
+        if (b->render != NULL) {
+            SDL_DestroyRenderer(b->render);
+            SDL_FreeSurface(b->stage);
+            SDL_FreeSurface(b->instr);
+        }
+        b->stage = SDL_CreateRGBSurfaceWithFormatFrom(stage_surf->pixels, stage_surf->w, stage_surf->h, 32, stage_surf->pitch, stage_surf->format->format);
+        b->instr = SDL_CreateRGBSurfaceWithFormatFrom(instr_surf->pixels, instr_surf->w, instr_surf->h, 32, instr_surf->pitch, instr_surf->format->format);
+        b->render = SDL_CreateSoftwareRenderer(b->stage);
+        b->surf_gen = surf_gen;
+    }
+    if (b->glyph_gen != glyph_gen) {
+        for(int i = 0; i < b->num_sets; i++) {
+            glyph_set_free(b->sets[i]);
+        }
+        for(int i = 0; i < '~' - ' ' + 1; i++) {
+            if (b->chars[i] != NULL) {
+                SDL_FreeSurface(b->chars[i]);
+            }
+            b->chars[i] = glyph_copy_surface(char_surfaces[i]);
+        }
+        for(int i = 0; i < num_glyph_sets; i++) {
+            b->sets[i] = glyph_set_new(b->chars, glyph_sets[i]->w, glyph_sets[i]->h);
+        }
+        b->num_sets = num_glyph_sets;
+        b->glyph_gen = glyph_gen;
+    }
+    return b;
+}
+
+void gfx_draw_band_job(void* arg, int index) {
+    // Draw one band of a parallel redraw through this thread's resources.
+    // The views share pixels with the real surfaces, and the bands don't
+    // overlap, so nothing needs copying back afterwards.
+    gfx_band_job_t* job = arg;
+    int y0 = job->area.y + job->area.h * index / job->n_bands;
+    int y1 = job->area.y + job->area.h * (index + 1) / job->n_bands;
+    band = gfx_get_band();
+    draw_stage = band->stage;
+    draw_instr = band->instr;
+    draw_render = band->render;
+    draw_org_x = job->org_x;
+    draw_org_y = job->org_y;
+    gfx_draw_band((SDL_Rect){job->area.x, y0, job->area.w, y1 - y0}, job->sidebar);
+    band = NULL;
+}
+
+void gfx_free_thread_caches() {
+    // Band resources and line strips kept by the calling thread
+    if (line_caches != NULL) {
+        for(int t = 0; t < OPTIONS->num_traces; t++) {
+            for(int i = 0; i < line_caches[t].n_strips; i++) {
+                line_strip_free(&line_caches[t].strips[i]);
+            }
+            free(line_caches[t].strips);
+        }
+        free(line_caches);
+        line_caches = NULL;
+    }
+    if (band_res != NULL) {
+        if (band_res->render != NULL) {
+            SDL_DestroyRenderer(band_res->render);
+            SDL_FreeSurface(band_res->stage);
+            SDL_FreeSurface(band_res->instr);
+        }
+        for(int i = 0; i < band_res->num_sets; i++) {
+            glyph_set_free(band_res->sets[i]);
+        }
+        for(int i = 0; i < '~' - ' ' + 1; i++) {
+            if (band_res->chars[i] != NULL) {
+                SDL_FreeSurface(band_res->chars[i]);
+            }
+        }
+        free(band_res);
+        band_res = NULL;
+    }
+}
+
+lod_level_t* gfx_get_trace_lod(int trace) {
+    // Pyramid level to draw a trace from, if zoomed out far enough that
+    // several of its instructions share a pixel row
+    double rows_per_px = 1.0 / (cam->scale * font_size.h * OPTIONS->num_traces);
+    int shift = (rows_per_px >= 1) ? (int)floor(log2(rows_per_px)) : 0;
+    return get_lod_level(trace, shift);
+}
+
+void gfx_draw_tiles(int64_t cam_x, int64_t cam_y) {
+    // Compose the stage surface from the tile cache, drawing the tiles it
+    // doesn't have in parallel first
+    int w = stage_surf->w;
+    int h = stage_surf->h;
+    int64_t col_0 = floor((double)cam_x / TILE_W);
+    int64_t col_1 = floor((double)(cam_x + w - 1) / TILE_W);
+    int64_t row_0 = floor((double)cam_y / TILE_H);
+    int64_t row_1 = floor((double)(cam_y + h - 1) / TILE_H);
+    int n = (col_1 - col_0 + 1) * (row_1 - row_0 + 1);
+    tile_t** view = malloc(sizeof(tile_t*) * n);
+    tile_t** missing = malloc(sizeof(tile_t*) * n);
+    int n_missing = 0;
+    tile_new_frame();
+    int i = 0;
+    for(int64_t r = row_0; r <= row_1; r++) {
+        for(int64_t c = col_0; c <= col_1; c++) {
+            tile_t* t = tile_find(r, c, cam->scale, cam->trace_off);
+            if (t == NULL) {
+                t = tile_alloc(r, c, cam->scale, cam->trace_off, cam->scale * font_size.h);
+                if (t != NULL) {
+                    missing[n_missing++] = t;
+                }
+            }
+            view[i++] = t;
+        }
+    }
+    pool_for(gfx_draw_tile_job, missing, n_missing);
+    i = 0;
+    SDL_Rect surf_rect = {0, 0, w, h};
+    for(int64_t r = row_0; r <= row_1; r++) {
+        for(int64_t c = col_0; c <= col_1; c++) {
+            SDL_Rect dst = {c * TILE_W - cam_x, r * TILE_H - cam_y, TILE_W, TILE_H};
+            if (view[i] != NULL) {
+                SDL_BlitSurface(view[i]->surf, NULL, stage_surf, &dst);
+            } else {
+                // Every tile is on screen already, draw this one in place
+                SDL_Rect clip;
+                SDL_IntersectRect(&dst, &surf_rect, &clip);
+                gfx_draw_area(clip, false);
+            }
+            i++;
+        }
+    }
+    free(view);
+    free(missing);
+}
+
+void gfx_draw_tile_job(void* arg, int index) {
+    // Draw one tile through this thread's band resources
+    tile_t* t = ((tile_t**)arg)[index];
+    band = gfx_get_band();
+    SDL_Renderer* rend = SDL_CreateSoftwareRenderer(t->surf);
+    draw_stage = t->surf;
+    draw_instr = band->instr;
+    draw_render = rend;
+    draw_org_x = t->col * TILE_W;
+    draw_org_y = t->row * TILE_H;
+    gfx_draw_band((SDL_Rect){0, 0, TILE_W, TILE_H}, false);
+    SDL_DestroyRenderer(rend);
+    t->ready = true;
+    band = NULL;
+}
+
+void gfx_prefetch_tile_job(void* arg, int index) {
+    // A tile drawn ahead while idle, not part of any frame's time
+    perf_skip_thread(true);
+    gfx_draw_tile_job(arg, index);
+    perf_skip_thread(false);
+}
+
+void gfx_prefetch_tiles() {
+    // Start drawing the tiles in a ring around the view on the workers, to be
+    // ready if the camera moves that way
+    if (!tiles_enabled() || stage_glyphs != NULL || pool_threads() == 0 || prefetch != NULL) {
+        return;
+    }
+    // Not while the view is drawn in blocks, they'd be kept as finished tiles
+    if (cam->interacting || draw_coarse) {
+        return;
+    }
+    int64_t cam_x = floor(cam->x_pos * font_size.w * cam->scale);
+    int64_t cam_y = floor(cam->y_pos * font_size.h * cam->scale);
+    int64_t col_0 = floor((double)cam_x / TILE_W) - 1;
+    int64_t col_1 = floor((double)(cam_x + stage_surf->w - 1) / TILE_W) + 1;
+    int64_t row_0 = floor((double)cam_y / TILE_H) - 1;
+    int64_t row_1 = floor((double)(cam_y + stage_surf->h - 1) / TILE_H) + 1;
+    if (row_0 < 0) row_0 = 0;
+    prefetch = malloc(sizeof(tile_t*) * 2 * ((col_1 - col_0 + 1) + (row_1 - row_0 + 1)));
+    n_prefetch = 0;
+    for(int64_t r = row_0; r <= row_1; r++) {
+        for(int64_t c = col_0; c <= col_1; c++) {
+            if (r != row_0 && r != row_1 && c != col_0 && c != col_1) {
+                continue;
+            }
+            if (tile_find(r, c, cam->scale, cam->trace_off) != NULL) {
+                continue;
+            }
+            tile_t* t = tile_alloc(r, c, cam->scale, cam->trace_off, cam->scale * font_size.h);
+            if (t == NULL) {
+                break;
+            }
+            prefetch[n_prefetch++] = t;
+        }
+    }
+    if (n_prefetch == 0 || !pool_start(gfx_prefetch_tile_job, prefetch, n_prefetch)) {
+        gfx_prefetch_finish();
+    }
+}
+
+void gfx_prefetch_finish() {
+    // Stop the prefetch, giving back the tiles it didn't get to
+    if (prefetch == NULL) {
+        return;
+    }
+    if (n_prefetch > 0) {
+        pool_finish(true);
+    }
+    for(int i = 0; i < n_prefetch; i++) {
+        if (!prefetch[i]->ready) {
+            tile_discard(prefetch[i]);
+        }
+    }
+    free(prefetch);
+    prefetch = NULL;
+    n_prefetch = 0;
+}
+
+void gfx_invalidate_view() {
+    // What is drawn has changed, not just where the camera is
+    tile_invalidate_all();
+    side_invalidate_all();
+    info_stale = true;
+    gfx_mark_dirty(DIRTY_VIEW);
+}
+
+void gfx_invalidate_row(uint64_t row) {
+    // Only one display row has changed
+    tile_invalidate_row(row);
+    side_invalidate_row(row);
+    info_stale = true;
+    gfx_mark_dirty(DIRTY_VIEW);
+}
+
+void gfx_draw_band(SDL_Rect area, bool sidebar) {
+    // Draw area into draw_stage, and the same rows of draw_instr if asked
+    SDL_Rect side = {0, area.y, draw_instr->w, area.h};
+    uint64_t start = perf_now();
+    SDL_SetClipRect(draw_stage, &area);
+    SDL_FillRect(draw_stage, &area, COLORS->bg.int_color);
+    SDL_RenderSetClipRect(draw_render, &area);
+    if (sidebar) {
+        SDL_SetClipRect(draw_instr, &side);
+        SDL_FillRect(draw_instr, &side, COLORS->bg.int_color);
+        if (instr_render != NULL && band == NULL) {
+            SDL_RenderSetClipRect(instr_render, &side);
+        }
+    }
+    perf_add(PERF_CLEAR, start);
+    draw_area = area;
+    draw_sidebar = sidebar;
+    
+    // Rows touching the area, plus one either side so that line segments
+    // running into it are drawn
+    double row_h = cam->scale * font_size.h;
+    int64_t row_0 = floor((draw_org_y + area.y) / row_h) - 1;
+    int64_t row_1 = ceil((draw_org_y + area.y + area.h) / row_h) + 1;
+    if (row_0 < 0) row_0 = 0;
     gfx_color_t color;
     // Draw data about traces
     for(int i = 0; i < OPTIONS->num_traces; i++) {
-        // Get what position to begin drawing
-        int64_t pos = y_pos - i;
-        uint64_t y_draw = (pos + OPTIONS->num_traces - 1) / OPTIONS->num_traces;    // ceiling division
-        uint64_t y_start = (pos + OPTIONS->num_traces) % OPTIONS->num_traces;
-        int off = trace_off;
+        // First and last instruction of this trace in those rows
+        uint64_t first = (row_0 <= i) ? 0 : (row_0 - i + OPTIONS->num_traces - 1) / OPTIONS->num_traces;    // ceiling division
+        int64_t last = (row_1 - i) / OPTIONS->num_traces;
+        if (last < (int64_t)first) {
+            continue;
+        }
+        int off = cam->trace_off;
+        start = perf_now();
         // Set color based on drawn trace
         color = COLORS->trace_b;
         if (i == focus) {
             color = COLORS->trace_a;
             off = 0;
         }
-        SDL_SetRenderDrawColor(stage_render, color.sdl_color.r, color.sdl_color.g, color.sdl_color.b, 0xFF);
+        // Far enough out that several instructions share a pixel row, draw
+        // from the trace's occupancy pyramid once it has been built
+        lod_level_t* lod = gfx_get_trace_lod(i);
+        if (lod != NULL) {
+            if (area.w > 0) {
+                gfx_draw_trace_lod(lod, i, color, OPTIONS->scale[i], off);
+            }
+            perf_add(PERF_TRACE + i, start);
+            continue;
+        }
+        if (cam->scale < line_cutoff && area.w > 0) {
+            gfx_draw_trace_lines(i, color, OPTIONS->scale[i], off);
+        }
         // Draw visible instructions and their stages
-        gfx_draw_trace_pos(y_draw, color, scale, screen_surface->h / font_size.h / scale / OPTIONS->num_traces + 3, i, OPTIONS->scale[i], OPTIONS->num_traces, y_start, off);
+        if (cam->scale >= line_cutoff || (sidebar && cam->scale >= draw_instr_cutoff)) {
+            gfx_draw_trace_pos(first, color, cam->scale, last - first + 1, i, OPTIONS->scale[i], OPTIONS->num_traces, off);
+        }
+        perf_add(PERF_TRACE + i, start);
     }
-    
-    // Draw box for scelected stage
-    color = COLORS->trace_b;
-    if (cycle.y % OPTIONS->num_traces == focus) {
-        color = COLORS->trace_a;
+    // Submit batched characters before anything is drawn over them
+    if (stage_glyphs != NULL && band == NULL) {
+        glyph_batch_flush(stage_glyphs);
+        glyph_batch_flush(instr_glyphs);
     }
-    gfx_draw_stage_box(color, cycle, stage_render);
     
-    // Setup info surface
-    setup_info(COLORS->ui);
-    
-    // Combine surfaces
+    SDL_SetClipRect(draw_stage, NULL);
+    SDL_RenderSetClipRect(draw_render, NULL);
+    if (sidebar) {
+        SDL_SetClipRect(draw_instr, NULL);
+        if (instr_render != NULL && band == NULL) {
+            SDL_RenderSetClipRect(instr_render, NULL);
+        }
+    }
+}
+
+void gfx_draw_trace_lines(int trace, gfx_color_t color, double trace_scale, int off) {
+    // Draw the line mode view of one trace inside draw_area from its cached
+    // strips
+    line_cache_t* cache = gfx_get_line_cache(trace, trace_scale, off);
+    for(int i = 0; i < cache->n_strips; i++) {
+        line_strip_draw(&cache->strips[i], draw_render, color.sdl_color, draw_org_x, draw_org_y, draw_org_y + draw_area.y - 1, draw_org_y + draw_area.y + draw_area.h + 1);
+    }
+}
+
+line_cache_t* gfx_get_line_cache(int trace, double trace_scale, int off) {
+    // Line mode strips of a trace covering draw_area, refilled first if the
+    // zoom has changed or the area isn't covered
+    if (line_caches == NULL) {
+        line_caches = calloc(OPTIONS->num_traces, sizeof(line_cache_t));
+    }
+    line_cache_t* cache = &line_caches[trace];
+    double row_h = cam->scale * font_size.h;
+    int64_t n_rows = TRACES[trace]->n_insts * OPTIONS->num_traces;
+    int64_t max_y = ceil(n_rows * row_h) + 1;
+    int64_t y0 = draw_org_y + draw_area.y - 1;
+    int64_t y1 = draw_org_y + draw_area.y + draw_area.h + 1;
+    if (y0 < 0) y0 = 0;
+    if (y1 > max_y) y1 = max_y;
+    if (cache->strips == NULL || cache->scale != cam->scale || cache->trace_scale != trace_scale || cache->off != off || cache->focus != focus || cache->gen != align_gen || y0 < cache->y0 || y1 > cache->y1) {
+        // Take in a screen either side so that scrolling reuses the strips
+        int64_t w0 = y0 - stage_surf->h;
+        int64_t w1 = y1 + stage_surf->h;
+        gfx_fill_line_cache(cache, trace, trace_scale, off, (w0 < 0) ? 0 : w0, (w1 > max_y) ? max_y : w1);
+    }
+    return cache;
+}
+
+void gfx_fill_line_cache(line_cache_t* cache, int trace, double trace_scale, int off, int64_t y0, int64_t y1) {
+    // Build the strips of each line spec for world pixel rows y0 up to y1
+    if (cache->strips == NULL) {
+        cache->n_strips = num_lines;
+        cache->strips = calloc(num_lines, sizeof(line_strip_t));
+    }
+    cache->scale = cam->scale;
+    cache->trace_scale = trace_scale;
+    cache->off = off;
+    cache->focus = focus;
+    cache->gen = align_gen;
+    cache->y0 = y0;
+    cache->y1 = y1;
+    for(int i = 0; i < cache->n_strips; i++) {
+        line_strip_clear(&cache->strips[i]);
+    }
+    int nt = OPTIONS->num_traces;
+    double row_h = cam->scale * font_size.h;
+    double cell_w = cam->scale * font_size.w;
+    // Instructions of this trace on those rows
+    int64_t row_0 = floor(y0 / row_h);
+    int64_t row_1 = ceil(y1 / row_h);
+    uint64_t first = (row_0 <= trace) ? 0 : (row_0 - trace + nt - 1) / nt;
+    int64_t last = (row_1 - trace) / nt;
+    uint64_t warp_hint = 0;
+    for(int64_t pos = first; pos <= last; pos++) {
+        instruction_t* inst = get_instr_at_pos(pos, trace);
+        if (inst == NULL) {
+            break;
+        }
+        if (inst->valid == false) {
+            continue;
+        }
+        int64_t y = floor((pos * nt + trace) * row_h);
+        line_sec_t* cur_line = gfx_lines;
+        for(int i = 0; i < cache->n_strips; i++) {
+            // First stage of the instruction the line connects
+            stage_t* stage = NULL;
+            for(int s = 0; s < inst->n_stages; s++) {
+                if (inst->stages[s].identifier == cur_line->connect) {
+                    stage = &inst->stages[s];
+                    break;
+                }
+            }
+            if (stage != NULL) {
+                int64_t x = floor(gfx_trace_to_world(trace, stage->cycle, trace_scale, off, &warp_hint) * cell_w);
+                line_strip_add(&cache->strips[i], x, y);
+            } else {
+                line_strip_skip(&cache->strips[i]);
+            }
+            cur_line = cur_line->next;
+        }
+    }
+    for(int i = 0; i < cache->n_strips; i++) {
+        line_strip_end(&cache->strips[i]);
+    }
+}
+
+void gfx_draw_trace_lod(lod_level_t* lod, int trace, gfx_color_t color, double trace_scale, int off) {
+    // Draw one trace inside draw_area from a level of its pyramid, a pixel row
+    // at a time. Pixels with fetches or commits get the trace color, others
+    // the pipeline passed through are shaded by how busy they were.
+    int nt = OPTIONS->num_traces;
+    int shift = lod->shift;
+    int cshift = lod->cycle_shift;
+    double row_h = cam->scale * font_size.h;
+    int x0 = draw_area.x;
+    int x1 = draw_area.x + draw_area.w;
+    uint32_t* occ = calloc(draw_area.w, sizeof(uint32_t));
+    uint8_t* mark = calloc(draw_area.w, sizeof(uint8_t));
+    assert(occ && mark);
+    // A full cell is every row busy for every cycle
+    double full_occ = (double)((uint64_t)1 << (shift + cshift));
+    Uint32 shades[LOD_SHADES];
+    for(int s = 0; s < LOD_SHADES; s++) {
+        double f = 0.2 + 0.5 * s / (LOD_SHADES - 1);
+        shades[s] = SDL_MapRGB(draw_stage->format, color.sdl_color.r * f, color.sdl_color.g * f, color.sdl_color.b * f);
+    }
+    Uint32 solid = SDL_MapRGB(draw_stage->format, color.sdl_color.r, color.sdl_color.g, color.sdl_color.b);
+    Uint32 bg = COLORS->bg.int_color;
+    uint64_t hint = 0;
+    for(int py = draw_area.y; py < draw_area.y + draw_area.h; py++) {
+        // Rows of this trace shown on this pixel row
+        int64_t r0 = ceil(((draw_org_y + py) / row_h - trace) / nt);
+        int64_t r1 = ceil(((draw_org_y + py + 1) / row_h - trace) / nt);
+        if (r0 < 0) r0 = 0;
+        if (r1 <= r0) continue;
+        uint64_t b0 = r0 >> shift;
+        uint64_t b1 = (r1 - 1) >> shift;
+        if (b0 >= lod->n_blocks) break;
+        if (b1 >= lod->n_blocks) b1 = lod->n_blocks - 1;
+        int lo = x1;
+        int hi = x0;
+        for(uint64_t b = b0; b <= b1; b++) {
+            for(uint64_t k = lod->offset[b]; k < lod->offset[b+1]; k++) {
+                lod_cell_t* cell = &lod->cells[k];
+                uint64_t cycle = (lod->first[b] + k - lod->offset[b]) << cshift;
+                int px0 = gfx_world_to_draw_px(gfx_trace_to_world(trace, cycle, trace_scale, off, &hint));
+                if (px0 >= x1) break;
+                int px1 = gfx_world_to_draw_px(gfx_trace_to_world(trace, cycle + ((uint64_t)1 << cshift), trace_scale, off, &hint));
+                if (px1 <= px0) px1 = px0 + 1;
+                if (px1 <= x0) continue;
+                if (px0 < x0) px0 = x0;
+                if (px1 > x1) px1 = x1;
+                for(int x = px0; x < px1; x++) {
+                    occ[x - x0] += cell->occ;
+                    mark[x - x0] |= (cell->fetch || cell->commit);
+                }
+                if (px0 < lo) lo = px0;
+                if (px1 > hi) hi = px1;
+            }
+        }
+        Uint32* pixels = (Uint32*)((uint8_t*)draw_stage->pixels + py * draw_stage->pitch);
+        for(int x = lo; x < hi; x++) {
+            if (mark[x - x0]) {
+                pixels[x] = solid;
+            } else if (occ[x - x0] > 0 && pixels[x] == bg) {
+                int s = occ[x - x0] / full_occ * LOD_SHADES;
+                pixels[x] = shades[(s < LOD_SHADES) ? s : LOD_SHADES - 1];
+            }
+            occ[x - x0] = 0;
+            mark[x - x0] = 0;
+        }
+    }
+    free(occ);
+    free(mark);
+}
+
+void gfx_draw_minimap() {
+    // Shade a column of the overview strip per trace, a pixel row covering
+    // whichever buckets fall on it. Only redone when the traces, the mode or
+    // the window size change, frames just blit it.
+    if (minimap_surf == NULL) return;
+    SDL_FillRect(minimap_surf, NULL, COLORS->bg.int_color);
+    if (!gfx_minimap_shown()) return;
+    int nt = MINIMAP->n_traces;
+    int nb = MINIMAP->n_buckets;
+    int h = minimap_surf->h;
+    int col_w = minimap_surf->w / nt;
+    for(int t = 0; t < nt; t++) {
+        gfx_color_t color = (t == focus) ? COLORS->trace_a : COLORS->trace_b;
+        for(int py = 0; py < h; py++) {
+            int b0 = (int64_t)py * nb / h;
+            int b1 = (int64_t)(py + 1) * nb / h;
+            if (b1 <= b0) b1 = b0 + 1;
+            double sum = 0;
+            int n = 0;
+            for(int b = b0; b < b1; b++) {
+                double f = minimap_shade(t, b, minimap_mode);
+                if (f >= 0) {
+                    sum += f;
+                    n ++;
+                }
+            }
+            if (n == 0) continue;
+            double f = 0.15 + 0.85 * sum / n;
+            // Leave a pixel between the columns
+            SDL_Rect px = {t * col_w, py, (t < nt - 1) ? col_w - 1 : minimap_surf->w - t * col_w, 1};
+            SDL_FillRect(minimap_surf, &px, SDL_MapRGB(minimap_surf->format, color.sdl_color.r * f, color.sdl_color.g * f, color.sdl_color.b * f));
+        }
+    }
+}
+
+bool gfx_minimap_shown() {
+    return MINIMAP != NULL && minimap_surf != NULL && minimap_mode < MINIMAP_MODES;
+}
+
+void gfx_scroll_surface(SDL_Surface* surf, int dx, int dy) {
+    // Move the pixels of a 32 bit surface by (dx, dy), leaving the uncovered
+    // strips as they were for the caller to redraw
+    int w = surf->w - abs(dx);
+    int h = surf->h - abs(dy);
+    if (w <= 0 || h <= 0 || (dx == 0 && dy == 0)) {
+        return;
+    }
+    uint8_t* pixels = surf->pixels;
+    int src_x = (dx < 0) ? -dx : 0;
+    int dst_x = (dx > 0) ? dx : 0;
+    // Copy rows in the order that never reads a row already overwritten
+    for(int i = 0; i < h; i++) {
+        int row = (dy > 0) ? h - 1 - i : i;
+        int src_y = (dy < 0) ? row - dy : row;
+        int dst_y = (dy > 0) ? row + dy : row;
+        memmove(pixels + dst_y * surf->pitch + dst_x * 4, pixels + src_y * surf->pitch + src_x * 4, w * 4);
+    }
+}
+
+void gfx_copy_surface(SDL_Surface* src, SDL_Surface* dst, int x, int y) {
+    // Copy a 32 bit surface into another at (x, y), inside its clip rect.
+    // Unlike SDL_BlitSurface it touches no state of either surface, so
+    // threads can copy from the same one at once.
+    SDL_Rect clip = dst->clip_rect;
+    int x0 = (x > clip.x) ? x : clip.x;
+    int y0 = (y > clip.y) ? y : clip.y;
+    int x1 = (x + src->w < clip.x + clip.w) ? x + src->w : clip.x + clip.w;
+    int y1 = (y + src->h < clip.y + clip.h) ? y + src->h : clip.y + clip.h;
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    for(int r = y0; r < y1; r++) {
+        memcpy((uint8_t*)dst->pixels + r * dst->pitch + x0 * 4, (uint8_t*)src->pixels + (r - y) * src->pitch + (x0 - x) * 4, (x1 - x0) * 4);
+    }
+}
+
+int gfx_world_to_px(double world_x) {
+    // Stage surface x of a world position, see gfx_draw_view
+    double cell_w = font_size.w * cam->scale;
+    return floor(world_x * cell_w) - floor(cam->x_pos * cell_w);
+}
+int gfx_row_to_px(uint64_t row) {
+    double row_h = font_size.h * cam->scale;
+    return floor(row * row_h) - floor(cam->y_pos * row_h);
+}
+int gfx_world_to_draw_px(double world_x) {
+    // Same, for the surface being drawn on this thread
+    return floor(world_x * font_size.w * cam->scale) - draw_org_x;
+}
+int gfx_row_to_draw_px(uint64_t row) {
+    return floor(row * font_size.h * cam->scale) - draw_org_y;
+}
+
+void gfx_compose(SDL_Rect* area) {
+    // Redraw every layer of the window, clipped to one area of it
+    if (area->w <= 0 || area->h <= 0) {
+        return;
+    }
+    SDL_SetClipRect(screen_surface, area);
+    SDL_FillRect(screen_surface, NULL, COLORS->ui.int_color);
     // Instruction sidebar
     SDL_Rect pos = (SDL_Rect){0, 0, instr_surf_width, screen_surface->h};
-    SDL_BlitSurface(instr_surf, &pos, screen_surface, &pos);
+    SDL_BlitSurface(instr_surf, NULL, screen_surface, &pos);
     // Instruction separating line
     pos = (SDL_Rect){instr_surf_width-4, 0, 4, screen_surface->h};
     SDL_FillRect(screen_surface, &pos, COLORS->ui.int_color);
     // Stage area
-    pos = (SDL_Rect){instr_surf_width, 0, stage_surf->w, screen_surface->h};
+    pos = (SDL_Rect){stage_surf_x, 0, stage_surf->w, screen_surface->h};
     SDL_BlitSurface(stage_surf, NULL, screen_surface, &pos);
+    // Box for scelected stage, kept inside the stage area
+    SDL_Rect box_clip;
+    pos = (SDL_Rect){stage_surf_x, 0, stage_surf->w, screen_surface->h};
+    if (SDL_IntersectRect(area, &pos, &box_clip)) {
+        SDL_SetClipRect(screen_surface, &box_clip);
+        uint64_t start = perf_now();
+        gfx_draw_box(hover_color, hover_rect, screen_surface);
+        perf_add(PERF_BOX, start);
+        SDL_SetClipRect(screen_surface, area);
+    }
+    // Overview strip, with the rows in view outlined
+    if (gfx_minimap_shown()) {
+        pos = (SDL_Rect){instr_surf_width, 0, minimap_surf->w, minimap_surf->h};
+        SDL_BlitSurface(minimap_surf, NULL, screen_surface, &pos);
+        double row_h = cam->scale * font_size.h * OPTIONS->num_traces;
+        double first_row = (double)cam->y_pos / OPTIONS->num_traces;
+        double px_per_row = (double)minimap_surf->h / MINIMAP->n_rows;
+        SDL_Rect view = {instr_surf_width, first_row * px_per_row, minimap_surf->w, stage_surf->h / row_h * px_per_row};
+        if (view.h < 3) view.h = 3;
+        gfx_draw_box(COLORS->ui, view, screen_surface);
+    }
     // Cmd info area
     pos = (SDL_Rect){0, screen_surface->h-cmd_surf->h, cmd_surf->w, cmd_surf->h};
     SDL_BlitSurface(cmd_surf, NULL, screen_surface, &pos);
@@ -271,13 +1185,25 @@ void gfx_update() {
         pos = (SDL_Rect){(screen_surface->w - help_surf->w) / 2, (screen_surface->h - help_surf->h) / 2, help_surf->w, help_surf->h};
         SDL_BlitSurface(help_surf, NULL, screen_surface, &pos);
     }
-    
-    
-    
-    SDL_UpdateWindowSurface(window);
+    SDL_SetClipRect(screen_surface, NULL);
+}
 
-    first = false;
-    
+void gfx_add_damage(SDL_Rect* damage, int* n_damage, SDL_Rect rect) {
+    // Keep only the on-screen part of the rect, dropping it if empty
+    SDL_Rect screen = {0, 0, screen_surface->w, screen_surface->h};
+    SDL_Rect clipped;
+    if (*n_damage < GFX_MAX_DAMAGE && SDL_IntersectRect(&rect, &screen, &clipped)) {
+        damage[(*n_damage)++] = clipped;
+    }
+}
+
+void gfx_mark_dirty(int regions) {
+    cam->dirty |= regions;
+}
+
+bool gfx_is_dirty() {
+    // Whether input has changed anything since the last frame was started
+    return input_view->dirty != 0;
 }
 
 
@@ -292,12 +1218,16 @@ SDL_Rect gfx_get_font_size() {
     return size;
 }
 
-void gfx_draw_box(gfx_color_t color, SDL_Rect pos, SDL_Renderer* rend) {
-    SDL_SetRenderDrawColor(rend, color.sdl_color.r, color.sdl_color.g, color.sdl_color.b, 0xFF);
-    SDL_RenderDrawLine(rend, pos.x, pos.y, pos.x+pos.w, pos.y);
-    SDL_RenderDrawLine(rend, pos.x, pos.y, pos.x, pos.y+pos.h);
-    SDL_RenderDrawLine(rend, pos.x, pos.y+pos.h, pos.x+pos.w, pos.y+pos.h);
-    SDL_RenderDrawLine(rend, pos.x+pos.w, pos.y, pos.x+pos.w, pos.y+pos.h);
+void gfx_draw_box(gfx_color_t color, SDL_Rect pos, SDL_Surface* surf) {
+    // One pixel outline, the right and bottom edges sit inside pos
+    SDL_Rect edge = {pos.x, pos.y, pos.w, 1};
+    SDL_FillRect(surf, &edge, color.int_color);
+    edge.y = pos.y + pos.h - 1;
+    SDL_FillRect(surf, &edge, color.int_color);
+    edge = (SDL_Rect){pos.x, pos.y, 1, pos.h};
+    SDL_FillRect(surf, &edge, color.int_color);
+    edge.x = pos.x + pos.w - 1;
+    SDL_FillRect(surf, &edge, color.int_color);
 }
 
 void gfx_draw_text_scaled(SDL_Surface* surf, const char* text, SDL_Rect* text_pos, SDL_Color color, double x_scale, double y_scale, int l_clip, int r_clip) {
@@ -306,33 +1236,123 @@ void gfx_draw_text_scaled(SDL_Surface* surf, const char* text, SDL_Rect* text_po
     // Check bounds before we do any actual rendering
     if (l_clip != -1 && (text_pos->x < l_clip || text_pos->x >= r_clip)) return;
     
-    SDL_Surface* txt_surface = TTF_RenderText_Solid(cp_mono, text, color);
-    // Copy to intermediary surface
-    SDL_Surface* temp = SDL_CreateRGBSurface(0, txt_surface->w, txt_surface->h, 32, 0, 0, 0, 0);
-    SDL_FillRect(temp, NULL, COLORS->bg.int_color);
-    SDL_BlitSurface(txt_surface, NULL, temp, NULL);
-    // Display text scaled
-    text_pos->w = txt_surface->w * x_scale * txt_base_scale;
-    text_pos->h = txt_surface->h * y_scale * txt_base_scale;
-    SDL_BlitScaled(temp, NULL, surf, text_pos);
-    // Free created surfaces
-    SDL_FreeSurface(temp);
-    SDL_FreeSurface(txt_surface);
+    // Strings are rendered and scaled once, then copied from the cache
+    SDL_Surface* scaled = text_cache_find(text, color, x_scale, y_scale);
+    if (scaled == NULL) {
+        SDL_Surface* txt_surface = TTF_RenderText_Solid(cp_mono, text, color);
+        // Copy to intermediary surface
+        SDL_Surface* temp = SDL_CreateRGBSurface(0, txt_surface->w, txt_surface->h, 32, 0, 0, 0, 0);
+        SDL_FillRect(temp, NULL, COLORS->bg.int_color);
+        SDL_BlitSurface(txt_surface, NULL, temp, NULL);
+        // Scale it to the size it is displayed at
+        int w = txt_surface->w * x_scale * txt_base_scale;
+        int h = txt_surface->h * y_scale * txt_base_scale;
+        SDL_FreeSurface(txt_surface);
+        if (w <= 0 || h <= 0) {
+            SDL_FreeSurface(temp);
+            text_pos->w = (w > 0) ? w : 0;
+            text_pos->x += text_pos->w;
+            return;
+        }
+        scaled = SDL_CreateRGBSurface(0, w, h, 32, 0, 0, 0, 0);
+        SDL_BlitScaled(temp, NULL, scaled, NULL);
+        SDL_FreeSurface(temp);
+        text_cache_put(text, color, x_scale, y_scale, scaled);
+    }
+    // Display text
+    text_pos->w = scaled->w;
+    text_pos->h = scaled->h;
+    SDL_Rect dst = *text_pos;
+    SDL_BlitSurface(scaled, NULL, surf, &dst);
     // Increment position
     text_pos->x += text_pos->w;
 }
 void gfx_draw_char_scaled(SDL_Surface* surf, char c, SDL_Rect* text_pos, SDL_Color color, double x_scale, double y_scale, int l_clip, int r_clip) {
     if (c < ' ' || c > '~') return;
     if (l_clip != -1 && (text_pos->x < l_clip || text_pos->x >= r_clip)) return;
-    // Use already-created surface containing the character we want to draw
-    SDL_Surface* char_surf = char_surfaces[c-' '];
+    // Use already-created surface containing the character we want to draw,
+    // this thread's own copies when drawing a band
+    SDL_Surface** chars = (band != NULL) ? band->chars : char_surfaces;
+    glyph_set_t** sets = (band != NULL) ? band->sets : glyph_sets;
+    int num_sets = (band != NULL) ? band->num_sets : num_glyph_sets;
+    SDL_Surface* char_surf = chars[c-' '];
+    text_pos->w = floor(((double)char_surf->w) * x_scale * txt_base_scale);
+    text_pos->h = floor(((double)char_surf->h) * y_scale * txt_base_scale);
+    // Queue it in the atlas batch for this surface if there is one
+    glyph_batch_t* batch = NULL;
+    if (surf == stage_surf)         batch = stage_glyphs;
+    else if (surf == instr_surf)    batch = instr_glyphs;
+    if (batch != NULL) {
+        glyph_batch_add(batch, c, text_pos, color);
+        return;
+    }
+    // Use the glyph pre-scaled to this size if there is one
+    for(int i = 0; i < num_sets; i++) {
+        if (sets[i]->w == text_pos->w && sets[i]->h == text_pos->h) {
+            if (glyph_can_blend(surf)) {
+                glyph_blend_mask(surf, sets[i]->masks[c-' '], sets[i]->w, sets[i]->h, text_pos->x, text_pos->y, color);
+                return;
+            }
+            SDL_Surface* glyph = sets[i]->glyphs[c-' '];
+            SDL_SetSurfaceColorMod(glyph, color.r, color.g, color.b);
+            SDL_Rect dst = *text_pos;
+            SDL_BlitSurface(glyph, NULL, surf, &dst);
+            return;
+        }
+    }
     // Set desired draw color
     SDL_SetSurfaceColorMod(char_surf, color.r, color.g, color.b);
     // Display character scaled
-    text_pos->w = floor(((double)char_surf->w) * x_scale * txt_base_scale);
-    text_pos->h = floor(((double)char_surf->h) * y_scale * txt_base_scale);
     SDL_BlitScaled(char_surf, NULL, surf, text_pos);
 }
+void gfx_bench_glyphs() {
+    // Time drawing a screen of characters through SDL's blitter against
+    // blending the coverage masks, and check they draw the same pixels
+    glyph_set_t* set = glyph_sets[0];
+    SDL_Surface* sdl_surf = SDL_CreateRGBSurface(0, stage_surf->w, stage_surf->h, 32, 0, 0, 0, 0);
+    SDL_Surface* mask_surf = SDL_CreateRGBSurface(0, stage_surf->w, stage_surf->h, 32, 0, 0, 0, 0);
+    int cols = stage_surf->w / set->w;
+    int rows = stage_surf->h / set->h;
+    const int passes = 50;
+    uint64_t n = (uint64_t)cols * rows * passes;
+    double secs[2];
+    for(int path = 0; path < 2; path++) {
+        SDL_Surface* surf = (path == 0) ? sdl_surf : mask_surf;
+        SDL_FillRect(surf, NULL, SDL_MapRGB(surf->format, 0x20, 0x20, 0x20));
+        uint64_t start = SDL_GetPerformanceCounter();
+        for(int p = 0; p < passes; p++) {
+            for(int y = 0; y < rows; y++) {
+                for(int x = 0; x < cols; x++) {
+                    int g = (x * 7 + y * 13 + p) % ('~' - ' ' + 1);
+                    SDL_Color color = {(x * 40) & 0xFF, (y * 70) & 0xFF, (p * 90) & 0xFF, 0xFF};
+                    if (path == 0) {
+                        SDL_SetSurfaceColorMod(set->glyphs[g], color.r, color.g, color.b);
+                        SDL_BlitSurface(set->glyphs[g], NULL, surf, &(SDL_Rect){x * set->w, y * set->h, set->w, set->h});
+                    } else {
+                        glyph_blend_mask(surf, set->masks[g], set->w, set->h, x * set->w, y * set->h, color);
+                    }
+                }
+            }
+        }
+        secs[path] = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    }
+    // Largest difference in any channel between the two
+    int max_diff = 0;
+    for(int y = 0; y < rows * set->h; y++) {
+        uint8_t* a = (uint8_t*)sdl_surf->pixels + y * sdl_surf->pitch;
+        uint8_t* b = (uint8_t*)mask_surf->pixels + y * mask_surf->pitch;
+        for(int x = 0; x < cols * set->w * 4; x++) {
+            int d = abs(a[x] - b[x]);
+            if (d > max_diff) max_diff = d;
+        }
+    }
+    printf("glyph bench: %"PRIu64" glyphs of %dx%d\n", n, set->w, set->h);
+    printf("    SDL_BlitSurface     %8.1f ns/glyph\n", secs[0] * 1e9 / n);
+    printf("    glyph_blend_mask    %8.1f ns/glyph (%s, %.2fx)\n", secs[1] * 1e9 / n, glyph_blend_name(), secs[0] / secs[1]);
+    printf("    max channel difference %d\n", max_diff);
+    SDL_FreeSurface(sdl_surf);
+    SDL_FreeSurface(mask_surf);
+}
 void gfx_gen_char_surfs() {
     char_surfaces = malloc(sizeof(SDL_Surface*) * ('~' - ' ' + 1));
     char c_ar[] = {' ', '\0'};
@@ -349,6 +1369,39 @@ void gfx_gen_char_surfs() {
         free(txt_surf);
         //char_surfaces[c-' '] = txt_surf;
     }
+    glyph_gen ++;
+}
+void gfx_add_glyph_set(double x_scale, double y_scale) {
+    // Sizes worked out the same way gfx_draw_char_scaled does
+    int w = floor(((double)char_surfaces[0]->w) * x_scale * txt_base_scale);
+    int h = floor(((double)char_surfaces[0]->h) * y_scale * txt_base_scale);
+    if (w <= 0 || h <= 0 || h > max_glyph_set_h || num_glyph_sets == GFX_GLYPH_SETS) {
+        return;
+    }
+    for(int i = 0; i < num_glyph_sets; i++) {
+        if (glyph_sets[i]->w == w && glyph_sets[i]->h == h) {
+            return;
+        }
+    }
+    glyph_sets[num_glyph_sets++] = glyph_set_new(char_surfaces, w, h);
+}
+void gfx_rescale_glyphs() {
+    // Rebuild the glyph sets for the current zoom: the panel text, the
+    // sidebar, and the stage characters of each trace
+    for(int i = 0; i < num_glyph_sets; i++) {
+        glyph_set_free(glyph_sets[i]);
+    }
+    num_glyph_sets = 0;
+    glyph_gen ++;
+    glyph_scale = cam->scale;
+    if (char_surfaces == NULL) {
+        return;
+    }
+    gfx_add_glyph_set(1, 1);
+    gfx_add_glyph_set(1, cam->scale);
+    for(int i = 0; i < OPTIONS->num_traces; i++) {
+        gfx_add_glyph_set(cam->scale * OPTIONS->scale[i], cam->scale);
+    }
 }
 void gfx_draw_text_colors_scaled(SDL_Surface* surf, const char* text, SDL_Rect* text_pos, gfx_color_t* colors, double x_scale, double y_scale, int l_clip, int r_clip) {
     if (text == NULL) return;
@@ -363,9 +1416,26 @@ void gfx_draw_text_colors_scaled(SDL_Surface* surf, const char* text, SDL_Rect*
     }    
 }
 void gfx_draw_text_highlight_scaled(SDL_Surface* surf, const char* text, SDL_Rect* text_pos, gfx_color_t def, double x_scale, double y_scale, int l_clip, int r_clip, int sec, char* param_name) {
-    gfx_color_t* colors = search_highlight(text, def, sec, param_name);
-    gfx_draw_text_colors_scaled(surf, text, text_pos, colors, x_scale, y_scale, l_clip, r_clip);
-    free(colors);
+    // Color each character by whether it is in a match of the search, or
+    // the current match
+    if (text == NULL) return;
+    int n_spans;
+    const search_span_t* spans = search_spans(text, sec, param_name, &n_spans);
+    int cur = search_cur_pos(text);
+    int k = 0;
+    for(int i = 0; text[i] != '\0'; i++) {
+        while (k < n_spans && spans[k].start + spans[k].len <= i) {
+            k++;
+        }
+        SDL_Color col = def.sdl_color;
+        if (cur >= 0 && i >= cur && i < cur + SEARCH->pattern_len) {
+            col = COLORS->cur_search.sdl_color;
+        } else if (k < n_spans && i >= spans[k].start) {
+            col = COLORS->highlight.sdl_color;
+        }
+        gfx_draw_char_scaled(surf, text[i], text_pos, col, x_scale, y_scale, l_clip, r_clip);
+        text_pos->x += text_pos->w;
+    }
 }
 
 
@@ -403,18 +1473,82 @@ stage_t* gfx_get_stage(uint64_t x, uint64_t y, int trace) {
     return NULL;
 }
 
-void gfx_draw_trace_pos(uint64_t y, gfx_color_t color, double scale, int num_disp, int trace, double trace_scale, int num_trace, int y_start, int off) {
+void gfx_draw_side_text(SDL_Surface* surf, instruction_t* inst, gfx_color_t color, double draw_scale_y, int y) {
+    SDL_Rect text_pos = {0, y, 0, 0};
+    // Draw program counter
+    char* pc_text = inst->pc_text;
+    // Color program counter based on results of search
+    gfx_draw_text_highlight_scaled(surf, pc_text, &text_pos, color, 1, draw_scale_y, -1, -1, SEARCHSEC_PC, NULL);
+    
+    // Draw trace instruction
+    text_pos.x += 10;
+    char* instr_text = inst->instruction;
+    double trace_x_scale = ((double)(instr_surf_width - text_pos.x)) / ((double)((strlen(instr_text) + 1) * font_size.w));
+    //if (trace_x_scale > 1) {
+        trace_x_scale = 1;
+    //}
+    // Color trace instruction based on results of search
+    gfx_draw_text_highlight_scaled(surf, instr_text, &text_pos, color, trace_x_scale, draw_scale_y, -1, -1, SEARCHSEC_INSTR, NULL);
+}
+
+void gfx_draw_side_row(instruction_t* inst, uint64_t row, gfx_color_t color, double draw_scale_y, int y) {
+    // Copy the row's text from the sidebar cache, drawing it there first if
+    // it isn't in it. Drawing through the glyph atlas doesn't go through the
+    // cache.
+    if (side_rows_enabled() && instr_glyphs == NULL) {
+        side_row_t* r = side_find(row, cam->scale, instr_surf_width, color.int_color);
+        if (r == NULL) {
+            r = side_alloc(row, cam->scale, instr_surf_width, color.int_color, ceil(cam->scale * font_size.h));
+            if (r != NULL) {
+                SDL_FillRect(r->surf, NULL, COLORS->bg.int_color);
+                gfx_draw_side_text(r->surf, inst, color, draw_scale_y, 0);
+                side_ready(r);
+            }
+        }
+        if (r != NULL) {
+            gfx_copy_surface(r->surf, draw_instr, 0, y);
+            return;
+        }
+    }
+    gfx_draw_side_text(draw_instr, inst, color, draw_scale_y, y);
+}
+
+bool gfx_draw_span_block(stage_t* stage, uint64_t cycle, uint64_t len, gfx_color_t color, int trace, double trace_scale, int off, int y, uint64_t row, uint64_t* warp_hint) {
+    // Fill len cells from cycle with the stage's color, in place of its
+    // characters. Returns whether they start past the right of the area.
+    int x0 = gfx_world_to_draw_px(gfx_trace_to_world(trace, cycle, trace_scale, off, warp_hint));
+    int x1 = gfx_world_to_draw_px(gfx_trace_to_world(trace, cycle + len, trace_scale, off, warp_hint));
+    if (x0 >= draw_area.x + draw_area.w) {
+        return true;
+    }
+    int h = gfx_row_to_draw_px(row + 1) - y;
+    SDL_Color c = color.sdl_color;
+    if (stage == NULL) {
+        // Half-brightness if no stage, as for the characters
+        c.r = c.r / 2;
+        c.g = c.g / 2;
+        c.b = c.b / 2;
+    }
+    // Leave a pixel between cells and rows when they are big enough
+    int gap = (h > 3) ? 1 : 0;
+    SDL_Rect rect = {x0, y, x1 - x0 - ((x1 - x0 > 3) ? 1 : 0), h - gap};
+    if (rect.w > 0 && rect.h > 0) {
+        SDL_FillRect(draw_stage, &rect, SDL_MapRGB(draw_stage->format, c.r, c.g, c.b));
+    }
+    return false;
+}
+
+void gfx_draw_trace_pos(uint64_t y, gfx_color_t color, double scale, int num_disp, int trace, double trace_scale, int num_trace, int off) {
     double draw_scale_x = scale * trace_scale;
     double draw_scale_y = scale;
-    // Setup line position rects
-    SDL_Rect* line_pos = malloc(sizeof(SDL_Rect)*num_lines);
-    bool* line_prev_skip = malloc(sizeof(bool)*num_lines);
-    for(int i = 0; i < num_lines; i++) {
-        line_pos[i] = (SDL_Rect){-1, 0, 0, 0};
-        line_prev_skip[i] = false;
-    }
     SDL_Rect text_pos;
-    y_start = y_start * (draw_scale_y * font_size.h);
+    uint64_t warp_hint = 0;
+    int area_r = draw_area.x + draw_area.w;
+    // Earliest cycle that can land in the area, cells just left of it are
+    // still drawn as wide characters may reach into it
+    double px_w = scale * font_size.w;
+    double area_cycle = gfx_world_to_cycle(trace, (draw_area.x + draw_org_x) / px_w);
+    uint64_t first_cycle = (area_cycle > 3) ? floor(area_cycle) - 3 : 0;
     for(int i = 0; i < num_disp; i++) {
         uint64_t inst_pos = y + i;
         instruction_t * inst = get_instr_at_pos(inst_pos, trace);
@@ -425,73 +1559,52 @@ void gfx_draw_trace_pos(uint64_t y, gfx_color_t color, double scale, int num_dis
             continue;
         }
         text_pos.x = 0;
-        text_pos.y = i * draw_scale_y * font_size.h * num_trace + y_start;
+        text_pos.y = gfx_row_to_draw_px(inst_pos * num_trace + trace);
         if (text_pos.y < 0) {
             continue;
         }
         
-        if (draw_scale_y >= draw_instr_cutoff) {
-            // Draw program counter
-            char* pc_text = inst->pc_text;
-            // Color program counter based on results of search
-            gfx_color_t* colors = search_highlight(pc_text, color, SEARCHSEC_PC, NULL);
-            gfx_draw_text_colors_scaled(instr_surf, pc_text, &text_pos, colors, 1, draw_scale_y, -1, -1);
-            free(colors);
-            
-            // Draw trace instruction
-            text_pos.x += 10;
-            char* instr_text = inst->instruction;
-            double trace_x_scale = ((double)(instr_surf_width - text_pos.x)) / ((double)((strlen(instr_text) + 1) * font_size.w));
-            //if (trace_x_scale > 1) {
-                trace_x_scale = 1;
-            //}
-            // Color trace instruction based on results of search
-            colors = search_highlight(instr_text, color, SEARCHSEC_INSTR, NULL);
-            gfx_draw_text_colors_scaled(instr_surf, instr_text, &text_pos, colors, trace_x_scale, draw_scale_y, -1, -1);
-            free(colors);
+        if (draw_sidebar && draw_scale_y >= draw_instr_cutoff) {
+            gfx_draw_side_row(inst, inst_pos * num_trace + trace, color, draw_scale_y, text_pos.y);
         }
         
         // Draw cycle stages
         if (scale >= line_cutoff && inst->n_stages > 0) {
-            if (inst->n_stages > 0) {
-                int cur_cycle = inst->stages[0].cycle;
-                stage_t * cur_stage = NULL;
-                while(true) {
-                    // Search for first stage with current cycle
-                    bool all_less = true;
-                    for(int j = 0; j < inst->n_stages; j++) {
-                        if (inst->stages[j].cycle >= cur_cycle) {
-                            all_less = false;
-                        }
-                        if (inst->stages[j].cycle == cur_cycle) {
-                            cur_stage = &inst->stages[j];
-                            break;
-                        }
-                    }
-                    // Check if done
-                    if (all_less) {
+            uint32_t n_spans;
+            row_span_t* spans = row_spans(inst, trace, inst_pos, align_gen, &n_spans);
+            bool past_area = false;
+            for(uint32_t k = row_span_find(spans, n_spans, first_cycle); k < n_spans && !past_area; k++) {
+                row_span_t* span = &spans[k];
+                // Setup color based on stage parameters
+                gfx_color_t stage_color = gfx_get_overall_stage_color(inst, span->stage, trace, inst_pos, color);
+                if (draw_coarse) {
+                    past_area = gfx_draw_span_block(span->stage, span->cycle, span->len, stage_color, trace, trace_scale, off, text_pos.y, inst_pos * num_trace + trace, &warp_hint);
+                    continue;
+                }
+                // Get character string to put (either the stage symbol or -)
+                char c = '-';
+                SDL_Color char_color = stage_color.sdl_color;
+                if (span->stage != NULL) {
+                    c = span->stage->identifier;
+                } else {
+                    // Half-brightness if no stage
+                    char_color.r = char_color.r / 2;
+                    char_color.g = char_color.g / 2;
+                    char_color.b = char_color.b / 2;
+                }
+                uint64_t cur_cycle = (span->cycle > first_cycle) ? span->cycle : first_cycle;
+                for(; cur_cycle < span->cycle + span->len; cur_cycle++) {
+                    // Draw stage, if it lands in the area being drawn
+                    double cell_x = gfx_trace_to_world(trace, cur_cycle, trace_scale, off, &warp_hint);
+                    double cell_w = gfx_trace_to_world(trace, cur_cycle + 1, trace_scale, off, &warp_hint) - cell_x;
+                    text_pos.x = gfx_world_to_draw_px(cell_x);
+                    if (text_pos.x >= area_r) {
+                        past_area = true;
                         break;
                     }
-                    // Setup color based on stage parameters
-                    gfx_color_t stage_color = gfx_get_overall_stage_color(cur_stage, color);
-                    // Get character string to put (either the stage symbol or -)
-                    char c = '-';
-                    SDL_Color char_color = stage_color.sdl_color;
-                    if (cur_stage != NULL) {
-                        c = cur_stage->identifier;
-                    } else {
-                        // Half-brightness if no stage
-                        char_color.r = char_color.r / 2;
-                        char_color.g = char_color.g / 2;
-                        char_color.b = char_color.b / 2;
+                    if (text_pos.x + 2 * (cell_w * scale * font_size.w + 1) >= draw_area.x) {
+                        gfx_draw_char_scaled(draw_stage, c, &text_pos, char_color, cell_w * scale, draw_scale_y, (int)(-draw_scale_x) << 8, screen_surface->w);
                     }
-                    // Draw stage
-                    double cycle_pos = cur_cycle - ((double)x_pos / trace_scale) + off;
-                    text_pos.x = (cycle_pos * font_size.w * draw_scale_x);
-                    gfx_draw_char_scaled(stage_surf, c, &text_pos, char_color, draw_scale_x, draw_scale_y, (int)(-draw_scale_x) << 8, screen_surface->w);
-                    // Setup next loop
-                    cur_cycle ++;
-                    cur_stage = NULL;
                 }
             }
             
@@ -500,7 +1613,7 @@ void gfx_draw_trace_pos(uint64_t y, gfx_color_t color, double scale, int num_dis
             int cur_cycle = cur_stage->cycle;
             while(cur_stage != NULL) {
                 // Setup color based on stage parameters
-                gfx_color_t stage_color = gfx_get_overall_stage_color(cur_stage, color);
+                gfx_color_t stage_color = gfx_get_overall_stage_color(inst, cur_stage, trace, inst_pos, color);
                 //gfx_color_t stage_color = color;
                 // Get character string to put (either the stage symbol or -)
                 char c = '-';
@@ -518,108 +1631,73 @@ void gfx_draw_trace_pos(uint64_t y, gfx_color_t color, double scale, int num_dis
                     char_color.b = char_color.b / 2;
                 }
                 // Draw stage
-                double cycle_pos = cur_cycle - ((double)x_pos / trace_scale) + off;
+                double cycle_pos = cur_cycle - ((double)cam->x_pos / trace_scale) + off;
                 text_pos.x = (cycle_pos * font_size.w * draw_scale_x);
                 gfx_draw_char_scaled(stage_surf, c, &text_pos, char_color, draw_scale_x, draw_scale_y, (int)(-draw_scale_x) << 8, screen_surface->w);
                 cur_cycle ++;
             }
             for(int j = 0; j < n_stages; j++) {
-                double cycle_pos = cur_stage->cycle - ((double)x_pos / trace_scale) + off;
+                double cycle_pos = cur_stage->cycle - ((double)cam->x_pos / trace_scale) + off;
                 text_pos.x = (cycle_pos * font_size.w * draw_scale_x);
                 char c_ar[] = {cur_stage->identifier, '\0'};
                 gfx_draw_text_scaled(stage_surf, c_ar, &text_pos, color, draw_scale_x, draw_scale_y, 0, screen_surface->w);
                 cur_stage = cur_stage->next;
             }*/
-        } else {
-            // Line render
-            // Check if moved far enough to draw another line
-            if (text_pos.y > (line_pos[0].y + line_draw_precision - 1)) {
-                // Loop through line definitions
-                line_sec_t * cur_line = gfx_lines;
-                for(int i = 0; i < num_lines; i++) {
-                    // Loop through stages
-                    // Check if any stage ids match line
-                    bool matched_none = true;
-                    for(int s = 0; s < inst->n_stages; s++) {
-                        stage_t * cur_stage = &inst->stages[s];
-                        if (cur_line->connect == cur_stage->identifier) {
-                            // Draw line
-                            SDL_Rect line_pos2 = {(cur_stage->cycle - ((double)x_pos / trace_scale) + (double)off) * font_size.w * draw_scale_x, text_pos.y, 0, 0};
-                            if (line_pos[i].x != -1) {
-                                if (line_prev_skip[i]) {
-                                    SDL_SetRenderDrawColor(stage_render, color.sdl_color.r / 3, color.sdl_color.g / 3, color.sdl_color.b / 3, 0xFF);
-                                } else {
-                                    SDL_SetRenderDrawColor(stage_render, color.sdl_color.r, color.sdl_color.g, color.sdl_color.b, 0xFF);
-                                }
-                                SDL_RenderDrawLine(stage_render, line_pos[i].x, line_pos[i].y, line_pos2.x, line_pos2.y);
-                                matched_none = false;
-                            }
-                            line_pos[i] = line_pos2;
-                            break;
-                        }
-                    }
-                    line_prev_skip[i] = matched_none;
-                    cur_line = cur_line->next;
-                }
-                
-                // Loop through stages
-                // for(int s = 0; s < inst->n_stages; s++) {
-                //     stage_t * cur_stage = &inst->stages[s];
-                //     // Check if stage id matches any lines
-                //     line_sec_t* cur_line = gfx_lines;
-                //     bool matched_none = true;
-                //     for(int i = 0; i < num_lines; i++) {
-                //         if (cur_line->connect == cur_stage->identifier) {
-                //             // Draw line
-                //             SDL_Rect line_pos2 = {(cur_stage->cycle - ((double)x_pos / trace_scale) + (double)off) * font_size.w * draw_scale_x, text_pos.y, 0, 0};
-                //             if (line_pos[i].x != -1) {
-                //                 SDL_RenderDrawLine(stage_render, line_pos[i].x, line_pos[i].y, line_pos2.x, line_pos2.y);
-                //             }
-                //             line_pos[i] = line_pos2;
-                //             matched_none = false;
-                //             break;
-                //         }
-                //         if (matched_none) {
-                //             line_pos[i].x = -1;
-                //         }
-                //         cur_line = cur_line->next;
-                //     }
-                // }
-                
-            }
         }
         
     }
-
-    free(line_pos);
-    free(line_prev_skip);
 }
 
-void gfx_draw_stage_box(gfx_color_t color, cycle_pos_t pos, SDL_Renderer* rend) {
+SDL_Rect gfx_get_stage_box_rect(cycle_pos_t pos) {
+    // Window area covered by the box around a stage
     SDL_Rect rect;
-    rect.x = ((pos.x * OPTIONS->scale[pos.trace]- x_pos) * scale  * font_size.w);
-    rect.y = ((pos.y - y_pos) * scale * font_size.h);
-    rect.w = scale * font_size.w * OPTIONS->scale[pos.trace];
-    rect.h = scale * font_size.h;
-    gfx_draw_box(color, rect, rend);
+    double cell_x = gfx_cycle_to_world(pos.trace, pos.x);
+    rect.x = gfx_world_to_px(cell_x) + stage_surf_x;
+    rect.y = gfx_row_to_px(pos.y);
+    rect.w = gfx_world_to_px(gfx_cycle_to_world(pos.trace, pos.x + 1)) + stage_surf_x - rect.x + 1;
+    rect.h = gfx_row_to_px(pos.y + 1) - rect.y + 1;
+    return rect;
 }
 
 
 
 
 SDL_Rect gfx_get_mouse_world_position(int mx, int my) {
-    int64_t x = (((double)(mx - instr_surf_width)) / scale / (double)font_size.w) + x_pos;
-    int64_t y = (((double)my) / scale / (double)font_size.h) + y_pos;
+    int64_t x = (((double)(mx - stage_surf_x)) / cam->scale / (double)font_size.w) + cam->x_pos;
+    int64_t y = (((double)my) / cam->scale / (double)font_size.h) + cam->y_pos;
     return (SDL_Rect){x, y, 0, 0};
 }
 cycle_pos_t gfx_get_mouse_stage_position(int mx, int my) {
-    uint64_t y = (((double)my) / scale / (double)font_size.h) + y_pos;
+    uint64_t y = (((double)my) / cam->scale / (double)font_size.h) + cam->y_pos;
     uint64_t trace = gfx_get_trace_num(y);
-    uint64_t x = ((((double)(mx - instr_surf_width)) / scale / (double)font_size.w) + x_pos) / OPTIONS->scale[trace];
+    double cycle = floor(gfx_world_to_cycle(trace, (((double)(mx - stage_surf_x)) / cam->scale / (double)font_size.w) + cam->x_pos));
+    uint64_t x = (cycle > 0) ? cycle : 0;
     uint64_t iy = gfx_get_instr_pos(y) * OPTIONS->num_traces + trace;
     return (cycle_pos_t){x, iy, trace};
 }
 
+double gfx_trace_to_world(int trace, double cycle, double trace_scale, int off, uint64_t* hint) {
+    // Place the second trace with the warp map if there is one, otherwise
+    // with its constant frequency scale
+    if (WARP != NULL && trace != focus) {
+        double c = (trace == 1) ? warp_map(cycle, hint) : warp_unmap(cycle, hint);
+        return (c + off) * OPTIONS->scale[focus];
+    }
+    return (cycle + off) * trace_scale;
+}
+double gfx_cycle_to_world(int trace, double cycle) {
+    int off = (trace != focus) ? cam->trace_off : 0;
+    return gfx_trace_to_world(trace, cycle, OPTIONS->scale[trace], off, NULL);
+}
+double gfx_world_to_cycle(int trace, double world_x) {
+    int off = (trace != focus) ? cam->trace_off : 0;
+    if (WARP != NULL && trace != focus) {
+        double c = world_x / OPTIONS->scale[focus] - off;
+        return (trace == 1) ? warp_unmap(c, NULL) : warp_map(c, NULL);
+    }
+    return world_x / OPTIONS->scale[trace] - off;
+}
+
 uint64_t gfx_get_instr_pos(uint64_t y_pos) {
     return y_pos / OPTIONS->num_traces;
 }
@@ -628,15 +1706,16 @@ int gfx_get_trace_num(uint64_t y_pos) {
 }
 
 void gfx_move(int xv, int yv, bool fast_move) {
-    if (fast_move && scale < 8) {
-        xv = (8 * xv) / scale;
-        yv = (8 * yv) / scale;
+    if (fast_move && cam->scale < 8) {
+        xv = (8 * xv) / cam->scale;
+        yv = (8 * yv) / cam->scale;
     }
-    x_pos += xv;
-    y_pos += yv;
-    if (y_pos < 0) {
-        y_pos = 0;
+    cam->x_pos += xv;
+    cam->y_pos += yv;
+    if (cam->y_pos < 0) {
+        cam->y_pos = 0;
     }
+    gfx_mark_dirty(DIRTY_SCROLL);
     gfx_snap_if_forced();
 }
 void gfx_snap_if_forced() {
@@ -649,29 +1728,27 @@ void gfx_snap() {
     // Loop through all traces and snap to the left-most one
     int64_t min_x = INT64_MAX;
     for(int i = 0; i < OPTIONS->num_traces; i++) {
-        instruction_t* instr = get_instr_at_pos(gfx_get_instr_pos(y_pos), i);
+        instruction_t* instr = get_instr_at_pos(gfx_get_instr_pos(cam->y_pos), i);
         if (instr != NULL && instr->valid == true) {
-            int64_t x = (instr->stages->cycle * OPTIONS->scale[i]) - 1;
-            // Add trace offset to camera shift if this trace gets offset
-            if (i != focus) {
-                x += (trace_off * OPTIONS->scale[i]);
-            }
+            // Trace offset (or warp) is included in the world position
+            int64_t x = gfx_cycle_to_world(i, instr->stages->cycle) - 1;
             if (x < min_x) {
                 min_x = x;
             }
         }
     }
-    x_pos = min_x;
+    cam->x_pos = min_x;
+    gfx_mark_dirty(DIRTY_SCROLL);
 }
 void gfx_toggle_force_snap() {
     force_snap = !force_snap;
 }
 void gfx_move_to_first() {
-    y_pos = 0;
+    cam->y_pos = 0;
     gfx_snap();
 }
 void gfx_move_to_last() {
-    y_pos = TRACES[0]->n_insts - 1;
+    cam->y_pos = TRACES[0]->n_insts - 1;
     gfx_snap();
 }
 
@@ -704,13 +1781,14 @@ void gfx_snap_to_cycle(int mx, int my) {
     if (instr == NULL)  return;
     // Get current position of that instruction
     int64_t stage_x = instr->stages[0].cycle;
-    if (scale < line_cutoff) {
+    if (cam->scale < line_cutoff) {
         // Add position of first stage drawn as a line
         stage_x += gfx_get_first_line_stage_pos(instr);
     }
     // Scale position & shift camera
     int64_t x = round(((double)stage_x) * OPTIONS->scale[0]);
-    x_pos -= pos.x - x;
+    cam->x_pos -= pos.x - x;
+    gfx_mark_dirty(DIRTY_VIEW);
     
     if (OPTIONS->num_traces <= 1) return;
 
@@ -721,15 +1799,17 @@ void gfx_snap_to_cycle(int mx, int my) {
     if (instr == NULL) return;
     // Get current position of that instruction
     stage_x = instr->stages[0].cycle;
-    if (scale < line_cutoff) {
+    if (cam->scale < line_cutoff) {
         // Add position of first stage drawn as a line
         stage_x += gfx_get_first_line_stage_pos(instr);
     }
     // Scale position & shift trace
-    double fx = ((double)stage_x) * OPTIONS->scale[1];
+    cam->trace_off = 0;
+    double fx = gfx_cycle_to_world(1, stage_x);
     double offset = (double)pos.x - fx;
-    trace_off = offset / OPTIONS->scale[1];
+    cam->trace_off = offset / ((WARP != NULL) ? OPTIONS->scale[focus] : OPTIONS->scale[1]);
 
+    gfx_mark_dirty(DIRTY_VIEW);
     gfx_snap_if_forced();
 }
 
@@ -737,36 +1817,93 @@ void gfx_inc_scale(int mx, int my) {
     // Get mouse position
     SDL_Rect pos = gfx_get_mouse_world_position(mx, my);
     // Scale
-    scale *= 0.75;
+    cam->scale *= 0.75;
+    gfx_interact();
+    gfx_mark_dirty(DIRTY_VIEW);
     // Correct position
-    int64_t x = pos.x - round(((double)mx - (double)instr_surf_width) / scale / (double)font_size.w);
-    int64_t y = pos.y - round(((double)my) / scale / (double)font_size.h);
+    int64_t x = pos.x - round(((double)mx - (double)stage_surf_x) / cam->scale / (double)font_size.w);
+    int64_t y = pos.y - round(((double)my) / cam->scale / (double)font_size.h);
     if (x < 0) x = 0;
     if (y < 0) y = 0;
-    x_pos = x;
-    y_pos = y;
+    cam->x_pos = x;
+    cam->y_pos = y;
     gfx_snap_if_forced();
 }
 void gfx_dec_scale(int mx, int my) {
     // Get mouse position
     SDL_Rect pos = gfx_get_mouse_world_position(mx, my);
     // Scale
-    scale *= 1.333333333333333333333333;
+    cam->scale *= 1.333333333333333333333333;
+    gfx_interact();
+    gfx_mark_dirty(DIRTY_VIEW);
     // Correct position
-    int64_t x = pos.x - round(((double)mx - (double)instr_surf_width) / scale / (double)font_size.w);
-    int64_t y = pos.y - round(((double)my) / scale / (double)font_size.h);
+    int64_t x = pos.x - round(((double)mx - (double)stage_surf_x) / cam->scale / (double)font_size.w);
+    int64_t y = pos.y - round(((double)my) / cam->scale / (double)font_size.h);
     if (x < 0) x = 0;
     if (y < 0) y = 0;
-    x_pos = x;
-    y_pos = y;
+    cam->x_pos = x;
+    cam->y_pos = y;
     gfx_snap_if_forced();
 }
 
+void gfx_realign_local(int mx, int my) {
+    // Re-align the rows around the instruction under the mouse
+    if (OPTIONS->num_traces <= 1) return;
+    cycle_pos_t pos = gfx_get_mouse_stage_position(mx, my);
+    uint64_t row = gfx_get_instr_pos(pos.y);
+    uint32_t start = SDL_GetTicks();
+    // The pyramid builder reads the rows being changed
+    stop_lod_build();
+    uint64_t r0 = 0;
+    uint64_t r1 = 0;
+    uint64_t n_rows = realign_local(row, pos.trace, realign_radius, &r0, &r1);
+    align_gen ++;
+    if (n_rows > 0) {
+        // Everything kept by row is patched over the window rather than
+        // built again over the whole trace
+        splice_lod(r0, r1, n_rows);
+        splice_warp(r0, r1, n_rows);
+        splice_diverge_index(r0, r1, n_rows);
+        search_splice_matches(r0, r1, n_rows);
+        search_splice_index(r0, r1, n_rows);
+        splice_minimap(r0, r1, n_rows);
+        gfx_draw_minimap();
+        diverge_text[0] = '\0';
+        setup_cmd();
+        gfx_invalidate_view();
+        printf("realigned %" PRIu64 " rows around instruction %" PRIu64 " in %" PRIu32 " ms\n", n_rows, row, SDL_GetTicks() - start);
+        fflush(stdout);
+    } else {
+        // Nothing changed, only a pyramid cut short is built again
+        splice_lod(r0, r0, 0);
+    }
+}
+
+void gfx_jump_divergence(bool forward) {
+    // Move to the next or previous divergent region, leaving a few aligned
+    // rows above it for context
+    if (DIVERGE == NULL) return;
+    uint64_t row = gfx_get_instr_pos(cam->y_pos) + diverge_context;
+    int64_t i = diverge_find(row, forward);
+    if (i < 0) {
+        snprintf(diverge_text, sizeof(diverge_text), "No %s divergence (%" PRIu64 " total)", forward ? "later" : "earlier", DIVERGE->n);
+    } else {
+        diverge_t* d = &DIVERGE->regions[i];
+        uint64_t top = (d->start > diverge_context) ? d->start - diverge_context : 0;
+        cam->y_pos = top * OPTIONS->num_traces;
+        gfx_snap();
+        snprintf(diverge_text, sizeof(diverge_text), "Divergence %" PRId64 "/%" PRIu64 ": rows %" PRIu64 "-%" PRIu64 ", pad %" PRIu64 "/%" PRIu64 ", mismatch %" PRIu64,
+                 i + 1, DIVERGE->n, d->start, d->end - 1, d->pad[0], d->pad[1], d->mismatch);
+    }
+    setup_cmd();
+}
+
 void gfx_shift_trace(int m, bool fast) {
     if (fast) {
-        m = (4 * m) / scale;
+        m = (4 * m) / cam->scale;
     }
-    trace_off += m;
+    cam->trace_off += m;
+    gfx_mark_dirty(DIRTY_VIEW);
     gfx_snap_if_forced();
 }
 
@@ -782,16 +1919,19 @@ void make_instr_surf() {
         SDL_FreeSurface(instr_surf);
     }
     instr_surf = SDL_CreateRGBSurface(0, instr_surf_width, gfx_win_height, 32, 0, 0, 0, 0);
+    surf_gen ++;
 }
 void make_stage_surf() {
     if (stage_surf != NULL) {
         SDL_FreeSurface(stage_surf);
     }
-    int w = gfx_win_width - instr_surf_width;
+    stage_surf_x = instr_surf_width + (gfx_minimap_shown() ? minimap_width : 0);
+    int w = gfx_win_width - stage_surf_x;
     if (w < 16) {
         w = 16;
     }
     stage_surf = SDL_CreateRGBSurface(0, w, gfx_win_height, 32, 0, 0, 0, 0);
+    surf_gen ++;
 }
 void make_cmd_surf(int w, int h) {
     if (cmd_surf != NULL) {
@@ -800,39 +1940,81 @@ void make_cmd_surf(int w, int h) {
     cmd_surf = SDL_CreateRGBSurface(0, gfx_win_width, cmd_surf_height, 32, 0, 0, 0, 0);
     setup_cmd();
 }
+void make_minimap_surf() {
+    if (minimap_surf != NULL) {
+        SDL_FreeSurface(minimap_surf);
+    }
+    int h = gfx_win_height - cmd_surf_height;
+    if (h < 1) {
+        h = 1;
+    }
+    minimap_surf = SDL_CreateRGBSurface(0, minimap_width, h, 32, 0, 0, 0, 0);
+    gfx_draw_minimap();
+}
 
 void gfx_win_refresh() {
     gfx_win_resize(gfx_win_width, gfx_win_height);
 }
 
+void free_glyph_batches() {
+    glyph_batch_free(stage_glyphs);
+    glyph_batch_free(instr_glyphs);
+    stage_glyphs = NULL;
+    instr_glyphs = NULL;
+    if (instr_render != NULL) {
+        SDL_DestroyRenderer(instr_render);
+        instr_render = NULL;
+    }
+}
+void make_glyph_batches() {
+    // Atlas textures belong to the renderers of the instruction and stage
+    // surfaces, so they are rebuilt along with them
+    free_glyph_batches();
+    if (!OPTIONS->glyph_atlas || char_surfaces == NULL || stage_render == NULL) {
+        return;
+    }
+    instr_render = SDL_CreateSoftwareRenderer(instr_surf);
+    stage_glyphs = glyph_batch_new(stage_render, char_surfaces);
+    instr_glyphs = glyph_batch_new(instr_render, char_surfaces);
+}
+
 void gfx_win_resize(int w, int h) {
+    free_glyph_batches();
     SDL_DestroyRenderer(stage_render);
-    screen_surface = SDL_GetWindowSurface(window);
+    if (window != NULL) {
+        screen_surface = SDL_GetWindowSurface(window);
+    }
+    // A frame waiting to be put on screen was drawn at the old size
+    n_present = 0;
     gfx_win_width = w;
     gfx_win_height = h;
     make_instr_surf();
+    make_minimap_surf();
     make_stage_surf();
     make_cmd_surf(w, h);
     stage_render = SDL_CreateSoftwareRenderer(stage_surf);
+    make_glyph_batches();
+    gfx_mark_dirty(DIRTY_ALL);
 }
 
-gfx_color_t gfx_get_overall_stage_color(stage_t* stage, gfx_color_t def) {
+gfx_color_t gfx_get_overall_stage_color(instruction_t* inst, stage_t* stage, int trace, uint64_t row, gfx_color_t def) {
     if (stage == NULL) {
         return def;
     }
-    // Go through the fields in this stage and check if any of them match the current search
-    gfx_color_t color = def;
-    color = search_highlight_overall(stage->id_str, color, SEARCHSEC_ID, NULL);
-    color = search_highlight_overall(stage->name, color, SEARCHSEC_NAME, NULL);
-    for(int i = 0; i < stage->n_params; i++) {
-        parameter_t * param = &stage->params[i];
-        color = search_highlight_overall(param->name, color, SEARCHSEC_PARAM_NAME, param->name);
-        color = search_highlight_overall(param->value, color, SEARCHSEC_PARAM_VALUE, param->name);
+    // Looked up in the bitmap built when the search was entered, or checked
+    // field by field while it is being typed
+    if (!search_stage_match(trace, row, stage - inst->stages)) {
+        return def;
     }
-    return color;
+    return search_is_cur_stage(stage) ? COLORS->cur_search : COLORS->highlight;
 }
 
 void setup_cmd() {
+    // Drawn with the next frame, input can change what it shows mid-frame
+    gfx_mark_dirty(DIRTY_CMD);
+}
+
+void gfx_draw_cmd() {
     SDL_FillRect(cmd_surf, NULL, COLORS->bg.int_color);
     // Draw text to cmd surface
     SDL_Rect pos = {0, 8, 0, 0};
@@ -852,6 +2034,22 @@ void setup_cmd() {
         snprintf(text_buff, 32, "%d", instr_surf_width);
         gfx_draw_text_scaled(cmd_surf, "Instruction Window Width: ", &pos, COLORS->ui.sdl_color, cmd_scale, cmd_scale, -1, -1);
         gfx_draw_text_scaled(cmd_surf, text_buff, &pos, COLORS->ui.sdl_color, cmd_scale, cmd_scale, -1, -1);
+        // Last divergence jump
+        pos.x += 32;
+        gfx_draw_text_scaled(cmd_surf, diverge_text, &pos, COLORS->ui.sdl_color, cmd_scale, cmd_scale, -1, -1);
+        // What the overview strip shows, if anything
+        if (gfx_minimap_shown()) {
+            char minimap_text[64];
+            snprintf(minimap_text, sizeof(minimap_text), "Overview: %s, brightest %.2f", (minimap_mode == MINIMAP_IPC) ? "IPC" : "cycles in pipeline", MINIMAP->full[minimap_mode]);
+            pos.x += 32;
+            gfx_draw_text_scaled(cmd_surf, minimap_text, &pos, COLORS->ui.sdl_color, cmd_scale, cmd_scale, -1, -1);
+        }
+        // Current search hit
+        char search_text[128];
+        if (search_status(search_text, sizeof(search_text))) {
+            pos.x += 32;
+            gfx_draw_text_scaled(cmd_surf, search_text, &pos, COLORS->ui.sdl_color, cmd_scale, cmd_scale, -1, -1);
+        }
     } else if (input_mode == INMODE_SEARCH) {
         // Draw contents of search / colol jump
         char* pre_search_text = "(search) /";
@@ -865,15 +2063,25 @@ void setup_cmd() {
     pos = (SDL_Rect){0, 0, cmd_surf->w, 4};
     SDL_FillRect(cmd_surf, &pos, COLORS->ui.int_color);
 }
+void gfx_draw_perf_hud() {
+    // Frame times over the right end of the command bar, updated whenever
+    // something else is redrawn
+    char text[256];
+    perf_hud_text(text, sizeof(text));
+    const double hud_scale = 0.6;
+    int w = ceil(strlen(text) * font_size.w * hud_scale);
+    SDL_Rect pos = {cmd_surf->w - w - 8, 4, w + 8, cmd_surf->h - 4};
+    SDL_FillRect(cmd_surf, &pos, COLORS->bg.int_color);
+    pos = (SDL_Rect){cmd_surf->w - w - 4, (cmd_surf->h + 4 - font_size.h * hud_scale) / 2, 0, 0};
+    gfx_draw_text_scaled(cmd_surf, text, &pos, COLORS->ui.sdl_color, hud_scale, hud_scale, -1, -1);
+    cam->dirty |= DIRTY_CMD;
+}
 void setup_info(gfx_color_t color) {
     char text_buff[32];
     // Get checked stage
     int y = y_check / OPTIONS->num_traces;
     int trace = y_check % OPTIONS->num_traces;
     int x = x_check;
-    if (trace != focus) {
-        x -= trace_off;
-    }
     stage_t* stage = gfx_get_stage(x, y, trace);
     if (stage == NULL) {
         info_on = false;
@@ -938,6 +2146,7 @@ void setup_info(gfx_color_t color) {
 }
 
 void toggle_help() {
+    gfx_mark_dirty(DIRTY_HELP);
     if (help) {
         help = false;
         input_mode = INMODE_CAM;
@@ -979,6 +2188,7 @@ void setup_help() {
     gfx_draw_text_scaled(help_surf, "/", &pos, COLORS->ui.sdl_color, 1, 1, -1, -1);
     snprintf(text_buff, 16, "%d", num_help_pages);
     gfx_draw_text_scaled(help_surf, text_buff, &pos, COLORS->ui.sdl_color, 1, 1, -1, -1);
+    gfx_mark_dirty(DIRTY_HELP);
 }
 void gfx_help_page_inc() {
     if (help) {
@@ -1002,55 +2212,75 @@ void gfx_help_page_dec() {
 
 SDL_Rect gfx_get_win_text_size() {
     SDL_Rect size;
-    size.w = (screen_surface->w / scale / font_size.w);
-    size.h = screen_surface->h / scale / font_size.h;
+    size.w = (screen_surface->w / cam->scale / font_size.w);
+    size.h = screen_surface->h / cam->scale / font_size.h;
     return size;
 }
 
 
 void gfx_look_at(int64_t y_look, int64_t x_look) {
     // Floating point opperations crash and burn if zoomed too far out
-    if (scale < 0.01) {
+    if (cam->scale < 0.01) {
         return;
     }
     if (y_look >= 0) {
         // Make sure provided y location is visible on-screen
-        if (y_pos > y_look) {
-            y_pos = y_look;
+        if (cam->y_pos > y_look) {
+            cam->y_pos = y_look;
         } else {
-            double font_h = scale * font_size.h;
+            double font_h = cam->scale * font_size.h;
             int num_visible = (double)(gfx_win_height - info_height) / font_h;
-            if (y_look > (y_pos + num_visible - 1)) {
-                y_pos = y_look - num_visible + 1;
-                y_pos = y_look;
+            if (y_look > (cam->y_pos + num_visible - 1)) {
+                cam->y_pos = y_look - num_visible + 1;
+                cam->y_pos = y_look;
             }
         }
     }
     if (x_look >= 0) {
         // Make sure provided x location is visible on-screen
-        x_look = (double)x_look * OPTIONS->scale[y_look % 2];
-        if (y_look % 2 != focus) {
-            x_look += trace_off;
-        }
-        if (x_pos > x_look) {
-            x_pos = x_look;
+        x_look = gfx_cycle_to_world(gfx_get_trace_num(y_look), x_look);
+        if (cam->x_pos > x_look) {
+            cam->x_pos = x_look;
         } else {
-            double font_w = scale * font_size.w;
-            int num_visible = (double)(gfx_win_width - instr_surf_width) / font_w;
-            if (x_look > (x_pos + num_visible - 1)) {
-                x_pos = x_look - (num_visible / 2) + 4;
+            double font_w = cam->scale * font_size.w;
+            int num_visible = (double)stage_surf->w / font_w;
+            if (x_look > (cam->x_pos + num_visible - 1)) {
+                cam->x_pos = x_look - (num_visible / 2) + 4;
             }
         }
     }
+    gfx_mark_dirty(DIRTY_SCROLL);
     gfx_snap_if_forced();
 }
 
 void gfx_jump_y(uint64_t y_look) {
-    y_pos = y_look;
+    cam->y_pos = y_look;
     gfx_snap();
 }
 
 
+void gfx_cycle_minimap() {
+    // IPC, then time in the pipeline, then hidden
+    minimap_mode = (minimap_mode + 1) % (MINIMAP_MODES + 1);
+    // The stage area gives up or takes back the strip's column
+    gfx_win_refresh();
+    setup_cmd();
+    gfx_mark_dirty(DIRTY_ALL);
+}
+
+bool gfx_minimap_hit(int mx, int my) {
+    return gfx_minimap_shown() && mx >= instr_surf_width && mx < instr_surf_width + minimap_surf->w && my >= 0 && my < minimap_surf->h;
+}
+
+void gfx_minimap_jump(int my) {
+    // Center the view on the rows under the mouse in the overview strip
+    uint64_t row = (uint64_t)my * MINIMAP->n_rows / minimap_surf->h;
+    uint64_t half = stage_surf->h / (2 * cam->scale * font_size.h * OPTIONS->num_traces);
+    row = (row > half) ? row - half : 0;
+    gfx_jump_y(row * OPTIONS->num_traces);
+}
+
+
 void gfx_setup_int_color(SDL_Surface* surf, gfx_color_t* color) {
     color->int_color = SDL_MapRGB(surf->format, color->sdl_color.r, color->sdl_color.g, color->sdl_color.b);
 }
@@ -1061,17 +2291,19 @@ void gfx_begin_dragging(int mx, int my) {
     is_dragging = true;
     drag_orig_mx = mx;
     drag_orig_my = my;
-    drag_orig_x_pos = x_pos;
-    drag_orig_y_pos = y_pos;
+    drag_orig_x_pos = cam->x_pos;
+    drag_orig_y_pos = cam->y_pos;
 }
 
 void gfx_drag(int mx, int my) {
     if (is_dragging) {
         // Move camera based on dragging
-        int64_t to_x = (int64_t)drag_orig_x_pos - (int64_t)((double)(mx - drag_orig_mx) / (font_size.w * scale));
-        int64_t to_y = (int64_t)drag_orig_y_pos - (int64_t)((double)(my - drag_orig_my) / (font_size.h * scale));
-        if (to_x >= 0)  x_pos = to_x;
-        if (to_y >= 0)  y_pos = to_y;
+        int64_t to_x = (int64_t)drag_orig_x_pos - (int64_t)((double)(mx - drag_orig_mx) / (font_size.w * cam->scale));
+        int64_t to_y = (int64_t)drag_orig_y_pos - (int64_t)((double)(my - drag_orig_my) / (font_size.h * cam->scale));
+        if (to_x >= 0)  cam->x_pos = to_x;
+        if (to_y >= 0)  cam->y_pos = to_y;
+        gfx_interact();
+        gfx_mark_dirty(DIRTY_SCROLL);
     }
 }
 
@@ -1079,6 +2311,30 @@ void gfx_end_dragging() {
     is_dragging = false;
 }
 
+void gfx_interact() {
+    // Zooming or dragging, draw quickly until it stops
+    if (OPTIONS->refine_ms <= 0) return;
+    cam->interacting = true;
+    cam->interact_ticks = SDL_GetTicks();
+}
+
+int gfx_refine_wait() {
+    // Milliseconds until the view should be drawn properly, -1 if it is
+    if (!input_view->interacting) return -1;
+    uint32_t still = SDL_GetTicks() - input_view->interact_ticks;
+    return (still >= (uint32_t)OPTIONS->refine_ms) ? 0 : OPTIONS->refine_ms - still;
+}
+
+void gfx_refine() {
+    // Redraw at full quality once input has settled
+    if (gfx_refine_wait() != 0) return;
+    input_view->interacting = false;
+    if (coarse_drawn) {
+        coarse_drawn = false;
+        input_view->dirty |= DIRTY_VIEW;
+    }
+}
+
 
 
 bool isEven(int num) {
@@ -38,6 +38,8 @@
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include "dptv.h"
+#include "lod.h"
+#include "lines.h"
 
 
 // Color definition struct, some SDL routines expect a uint64_t for the color while some want an SDL_Color struct
@@ -66,24 +68,68 @@ void gfx_reset();
 void gfx_win_refresh();
 void gfx_win_resize(int w, int h);
 void gfx_update();
+void gfx_present();
 void gfx_draw_text_scaled(SDL_Surface* surf, const char* text, SDL_Rect* text_pos, SDL_Color color, double x_scale, double y_scale, int l_clip, int r_clip);
 void gfx_draw_char_scaled(SDL_Surface* surf, char c, SDL_Rect* text_pos, SDL_Color color, double x_scale, double y_scale, int l_clip, int r_clip);
 void gfx_gen_char_surfs();
+void gfx_bench_glyphs();
+void make_glyph_batches();
+void gfx_add_glyph_set(double x_scale, double y_scale);
+void gfx_rescale_glyphs();
+void free_glyph_batches();
 void gfx_draw_text_colors_scaled(SDL_Surface* surf, const char* text, SDL_Rect* text_pos, gfx_color_t* colors, double x_scale, double y_scale, int l_clip, int r_clip);
 void gfx_draw_text_highlight_scaled(SDL_Surface* surf, const char* text, SDL_Rect* text_pos, gfx_color_t def, double x_scale, double y_scale, int l_clip, int r_clip, int sec, char* param_name);
 SDL_Rect gfx_get_font_size();
-void gfx_draw_trace_pos(uint64_t y, gfx_color_t color, double scale, int num_disp, int trace, double trace_scale, int num_trace, int y_start, int off);
-void gfx_draw_box(gfx_color_t color, SDL_Rect pos, SDL_Renderer* rend);
-void gfx_draw_stage_box(gfx_color_t color, cycle_pos_t pos, SDL_Renderer* rend);
-gfx_color_t gfx_get_overall_stage_color(stage_t* stage, gfx_color_t def);
+void gfx_draw_side_text(SDL_Surface* surf, instruction_t* inst, gfx_color_t color, double draw_scale_y, int y);
+void gfx_draw_side_row(instruction_t* inst, uint64_t row, gfx_color_t color, double draw_scale_y, int y);
+bool gfx_draw_span_block(stage_t* stage, uint64_t cycle, uint64_t len, gfx_color_t color, int trace, double trace_scale, int off, int y, uint64_t row, uint64_t* warp_hint);
+void gfx_draw_trace_pos(uint64_t y, gfx_color_t color, double scale, int num_disp, int trace, double trace_scale, int num_trace, int off);
+void gfx_draw_view(bool redraw);
+void gfx_draw_tiles(int64_t cam_x, int64_t cam_y);
+void gfx_draw_tile_job(void* arg, int index);
+void gfx_prefetch_tile_job(void* arg, int index);
+void gfx_prefetch_tiles();
+void gfx_prefetch_finish();
+void gfx_invalidate_view();
+void gfx_invalidate_row(uint64_t row);
+SDL_Surface* gfx_render_viewport(uint64_t inst_0, uint64_t inst_1, double cycle_0, double cycle_1, double zoom, int off, int max_side);
+void gfx_draw_area(SDL_Rect area, bool sidebar);
+void gfx_draw_band_job(void* arg, int index);
+void gfx_free_thread_caches();
+void gfx_draw_band(SDL_Rect area, bool sidebar);
+lod_level_t* gfx_get_trace_lod(int trace);
+void gfx_draw_trace_lines(int trace, gfx_color_t color, double trace_scale, int off);
+line_cache_t* gfx_get_line_cache(int trace, double trace_scale, int off);
+void gfx_fill_line_cache(line_cache_t* cache, int trace, double trace_scale, int off, int64_t y0, int64_t y1);
+void gfx_draw_trace_lod(lod_level_t* lod, int trace, gfx_color_t color, double trace_scale, int off);
+void gfx_draw_minimap();
+bool gfx_minimap_shown();
+void gfx_scroll_surface(SDL_Surface* surf, int dx, int dy);
+void gfx_copy_surface(SDL_Surface* src, SDL_Surface* dst, int x, int y);
+int gfx_world_to_px(double world_x);
+int gfx_row_to_px(uint64_t row);
+int gfx_world_to_draw_px(double world_x);
+int gfx_row_to_draw_px(uint64_t row);
+void gfx_draw_box(gfx_color_t color, SDL_Rect pos, SDL_Surface* surf);
+SDL_Rect gfx_get_stage_box_rect(cycle_pos_t pos);
+void gfx_compose(SDL_Rect* area);
+void gfx_add_damage(SDL_Rect* damage, int* n_damage, SDL_Rect rect);
+void gfx_mark_dirty(int regions);
+bool gfx_is_dirty();
+gfx_color_t gfx_get_overall_stage_color(instruction_t* inst, stage_t* stage, int trace, uint64_t row, gfx_color_t def);
 void setup_info();
 void setup_help();
 void setup_cmd();
+void gfx_draw_cmd();
+void gfx_draw_perf_hud();
 void toggle_help();
 void gfx_help_page_inc();
 void gfx_help_page_dec();
 instruction_t* get_instr_at_pos(uint64_t pos, int trace);
 int gfx_get_trace_num(uint64_t y_pos);
+double gfx_trace_to_world(int trace, double cycle, double trace_scale, int off, uint64_t* hint);
+double gfx_cycle_to_world(int trace, double cycle);
+double gfx_world_to_cycle(int trace, double world_x);
 uint64_t gfx_get_instr_pos(uint64_t y_pos);
 
 cycle_pos_t gfx_get_mouse_stage_position(int mx, int my);
@@ -100,16 +146,24 @@ void gfx_snap_to_cycle(int mx, int my);
 void gfx_inc_scale(int mx, int my);
 void gfx_dec_scale(int mx, int my);
 void gfx_shift_trace(int m, bool fast_move);
+void gfx_realign_local(int mx, int my);
+void gfx_jump_divergence(bool forward);
 void gfx_look_at(int64_t y_pos, int64_t x_pos);
 void gfx_jump_y(uint64_t y_pos);
+void gfx_cycle_minimap();
+bool gfx_minimap_hit(int mx, int my);
+void gfx_minimap_jump(int my);
 void gfx_begin_dragging(int mx, int my);
 void gfx_drag(int mx, int my);
 void gfx_end_dragging();
+void gfx_interact();
+int gfx_refine_wait();
+void gfx_refine();
+void gfx_use_input_view();
+void gfx_take_view();
 
 void gfx_setup_int_color(SDL_Surface* surf, gfx_color_t* color);
 
-extern int64_t x_pos;
-extern int64_t y_pos;
 extern int focus;
 extern int input_mode;
 extern int instr_surf_width;
@@ -117,6 +171,15 @@ extern int instr_surf_width;
 #define INMODE_HELP    1
 #define INMODE_SEARCH  2
 
+// Parts of the window that need to be redrawn by gfx_update
+#define DIRTY_VIEW     0x01    // instruction and stage areas
+#define DIRTY_HOVER    0x02    // stage box and info panel
+#define DIRTY_CMD      0x04    // command bar
+#define DIRTY_HELP     0x08    // help menu
+#define DIRTY_SCROLL   0x10    // camera moved without anything else changing
+#define DIRTY_ALL      0x1F
+#define GFX_MAX_DAMAGE 8
+
 
 
 #endif
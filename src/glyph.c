@@ -0,0 +1,347 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glyph.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define GLYPH_X86
+#endif
+
+// Glyphs per row of the atlas
+static const int atlas_cols = 16;
+// Quads queued before the batch is flushed on its own
+#define GLYPH_BATCH_QUADS 16384
+
+static const int num_glyphs = '~' - ' ' + 1;
+
+// Copy every character surface into one atlas texture owned by the renderer
+glyph_batch_t * glyph_batch_new(SDL_Renderer * rend, SDL_Surface ** char_surfs) {
+    glyph_batch_t *batch = malloc(sizeof(glyph_batch_t));
+    assert(batch);
+    batch->rend = rend;
+    batch->n_quads = 0;
+
+    // All characters of a monospace font share a size, but use the largest
+    // to be safe
+    int cell_w = 0;
+    int cell_h = 0;
+    for(int i = 0; i < num_glyphs; i++) {
+        if (char_surfs[i]->w > cell_w) cell_w = char_surfs[i]->w;
+        if (char_surfs[i]->h > cell_h) cell_h = char_surfs[i]->h;
+    }
+    int rows = (num_glyphs + atlas_cols - 1) / atlas_cols;
+    batch->atlas_w = cell_w * atlas_cols;
+    batch->atlas_h = cell_h * rows;
+    SDL_PixelFormat *f = char_surfs[0]->format;
+    SDL_Surface *sheet = SDL_CreateRGBSurface(0, batch->atlas_w, batch->atlas_h, 32, f->Rmask, f->Gmask, f->Bmask, f->Amask);
+    assert(sheet);
+    for(int i = 0; i < num_glyphs; i++) {
+        SDL_Surface *c = char_surfs[i];
+        SDL_Rect cell = {(i % atlas_cols) * cell_w, (i / atlas_cols) * cell_h, c->w, c->h};
+        // Copy the glyph with its alpha, in white so vertex colors tint it
+        SDL_SetSurfaceColorMod(c, 0xFF, 0xFF, 0xFF);
+        SDL_SetSurfaceBlendMode(c, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(c, NULL, sheet, &cell);
+        SDL_SetSurfaceBlendMode(c, SDL_BLENDMODE_BLEND);
+        batch->cells[i] = cell;
+    }
+    batch->atlas = SDL_CreateTextureFromSurface(rend, sheet);
+    SDL_FreeSurface(sheet);
+    if (batch->atlas == NULL) {
+        fprintf(stderr, "ERROR: failed to create glyph atlas. %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    SDL_SetTextureBlendMode(batch->atlas, SDL_BLENDMODE_BLEND);
+
+    // Quads share one index pattern, so the index buffer is filled once
+    batch->verts = malloc(sizeof(SDL_Vertex) * 4 * GLYPH_BATCH_QUADS);
+    batch->indices = malloc(sizeof(int) * 6 * GLYPH_BATCH_QUADS);
+    assert(batch->verts && batch->indices);
+    for(int q = 0; q < GLYPH_BATCH_QUADS; q++) {
+        int *idx = &batch->indices[q * 6];
+        idx[0] = q*4;   idx[1] = q*4 + 1;   idx[2] = q*4 + 2;
+        idx[3] = q*4;   idx[4] = q*4 + 2;   idx[5] = q*4 + 3;
+    }
+    return batch;
+}
+
+void glyph_batch_free(glyph_batch_t * batch) {
+    if (batch == NULL) {
+        return;
+    }
+    SDL_DestroyTexture(batch->atlas);
+    free(batch->verts);
+    free(batch->indices);
+    free(batch);
+}
+
+// Queue one character, stretched over dst and tinted with color
+void glyph_batch_add(glyph_batch_t * batch, char c, const SDL_Rect * dst, SDL_Color color) {
+    if (c < ' ' || c > '~' || dst->w <= 0 || dst->h <= 0) {
+        return;
+    }
+    if (batch->n_quads == GLYPH_BATCH_QUADS) {
+        glyph_batch_flush(batch);
+    }
+    SDL_Rect *cell = &batch->cells[c - ' '];
+    float u0 = (float)cell->x / batch->atlas_w;
+    float v0 = (float)cell->y / batch->atlas_h;
+    float u1 = (float)(cell->x + cell->w) / batch->atlas_w;
+    float v1 = (float)(cell->y + cell->h) / batch->atlas_h;
+    float x0 = dst->x;
+    float y0 = dst->y;
+    float x1 = dst->x + dst->w;
+    float y1 = dst->y + dst->h;
+    color.a = 0xFF;
+    SDL_Vertex *v = &batch->verts[batch->n_quads * 4];
+    v[0] = (SDL_Vertex){{x0, y0}, color, {u0, v0}};
+    v[1] = (SDL_Vertex){{x1, y0}, color, {u1, v0}};
+    v[2] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+    v[3] = (SDL_Vertex){{x0, y1}, color, {u0, v1}};
+    batch->n_quads ++;
+}
+
+// Submit the queued quads and wait for them to land on the target surface
+void glyph_batch_flush(glyph_batch_t * batch) {
+    if (batch->n_quads > 0) {
+        SDL_RenderGeometry(batch->rend, batch->atlas, batch->verts, batch->n_quads * 4, batch->indices, batch->n_quads * 6);
+        batch->n_quads = 0;
+    }
+    SDL_RenderFlush(batch->rend);
+}
+
+// Scale every character surface to w x h, keeping the alpha channel
+glyph_set_t * glyph_set_new(SDL_Surface ** char_surfs, int w, int h) {
+    glyph_set_t *set = malloc(sizeof(glyph_set_t));
+    assert(set);
+    set->w = w;
+    set->h = h;
+    for(int i = 0; i < num_glyphs; i++) {
+        SDL_Surface *c = char_surfs[i];
+        SDL_PixelFormat *f = c->format;
+        SDL_Surface *g = SDL_CreateRGBSurface(0, w, h, 32, f->Rmask, f->Gmask, f->Bmask, f->Amask);
+        assert(g);
+        SDL_SetSurfaceColorMod(c, 0xFF, 0xFF, 0xFF);
+        SDL_SetSurfaceBlendMode(c, SDL_BLENDMODE_NONE);
+        SDL_BlitScaled(c, NULL, g, NULL);
+        SDL_SetSurfaceBlendMode(c, SDL_BLENDMODE_BLEND);
+        SDL_SetSurfaceBlendMode(g, SDL_BLENDMODE_BLEND);
+        set->glyphs[i] = g;
+        set->masks[i] = malloc(w * h);
+        assert(set->masks[i]);
+        for(int y = 0; y < h; y++) {
+            uint32_t *row = (uint32_t *)((uint8_t *)g->pixels + y * g->pitch);
+            for(int x = 0; x < w; x++) {
+                uint8_t r, gr, b, a;
+                SDL_GetRGBA(row[x], f, &r, &gr, &b, &a);
+                set->masks[i][y * w + x] = a;
+            }
+        }
+    }
+    return set;
+}
+
+void glyph_set_free(glyph_set_t * set) {
+    if (set == NULL) {
+        return;
+    }
+    for(int i = 0; i < num_glyphs; i++) {
+        SDL_FreeSurface(set->glyphs[i]);
+        free(set->masks[i]);
+    }
+    free(set);
+}
+
+// Copy of a surface made without blitting from it, so it is safe while other
+// threads draw with the original
+SDL_Surface * glyph_copy_surface(SDL_Surface * src) {
+    SDL_Surface *dst = SDL_CreateRGBSurfaceWithFormat(0, src->w, src->h, src->format->BitsPerPixel, src->format->format);
+    assert(dst);
+    int row = src->w * src->format->BytesPerPixel;
+    for(int y = 0; y < src->h; y++) {
+        memcpy((uint8_t *)dst->pixels + y * dst->pitch, (uint8_t *)src->pixels + y * src->pitch, row);
+    }
+    SDL_SetSurfaceBlendMode(dst, SDL_BLENDMODE_BLEND);
+    return dst;
+}
+
+// Blending a coverage mask straight into the target, instead of through
+// SDL's general blitter, works on any 32 bit format: each byte of the target
+// pixel moves toward the same byte of the tint mapped to that format.
+bool glyph_can_blend(SDL_Surface * dst) {
+    return dst->format->BytesPerPixel == 4 && !SDL_MUSTLOCK(dst);
+}
+
+// (a * c + (255 - a) * d) / 255, rounded
+static inline uint32_t glyph_lerp(uint32_t c, uint32_t d, uint32_t a) {
+    uint32_t t = a * c + (255 - a) * d + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static void glyph_blend_row_scalar(uint32_t *dst, const uint8_t *mask, int n, uint32_t color) {
+    for(int i = 0; i < n; i++) {
+        uint32_t a = mask[i];
+        if (a == 0) {
+            continue;
+        }
+        if (a == 255) {
+            dst[i] = color;
+            continue;
+        }
+        uint32_t d = dst[i];
+        dst[i] = glyph_lerp(color & 0xFF, d & 0xFF, a)
+              | glyph_lerp((color >> 8) & 0xFF, (d >> 8) & 0xFF, a) << 8
+              | glyph_lerp((color >> 16) & 0xFF, (d >> 16) & 0xFF, a) << 16
+              | glyph_lerp(color >> 24, d >> 24, a) << 24;
+    }
+}
+
+#ifdef GLYPH_X86
+// Four pixels at a time, each channel widened to 16 bits
+__attribute__((target("ssse3")))
+static void glyph_blend_row_ssse3(uint32_t *dst, const uint8_t *mask, int n, uint32_t color) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c16 = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+    const __m128i v255 = _mm_set1_epi16(255);
+    const __m128i v128 = _mm_set1_epi16(128);
+    // Spreads the alpha of pixels 0 and 1 (or 2 and 3) over their channels
+    const __m128i spread_lo = _mm_setr_epi8(0, -1, 0, -1, 0, -1, 0, -1, 1, -1, 1, -1, 1, -1, 1, -1);
+    const __m128i spread_hi = _mm_setr_epi8(2, -1, 2, -1, 2, -1, 2, -1, 3, -1, 3, -1, 3, -1, 3, -1);
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        uint32_t m;
+        memcpy(&m, mask + i, 4);
+        if (m == 0) {
+            continue;
+        }
+        __m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+        __m128i mv = _mm_cvtsi32_si128(m);
+        __m128i a_lo = _mm_shuffle_epi8(mv, spread_lo);
+        __m128i a_hi = _mm_shuffle_epi8(mv, spread_hi);
+        __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+        __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+        __m128i t_lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(c16, a_lo), _mm_mullo_epi16(d_lo, _mm_sub_epi16(v255, a_lo))), v128);
+        __m128i t_hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(c16, a_hi), _mm_mullo_epi16(d_hi, _mm_sub_epi16(v255, a_hi))), v128);
+        t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+        t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(t_lo, t_hi));
+    }
+    glyph_blend_row_scalar(dst + i, mask + i, n - i, color);
+}
+
+// Eight pixels at a time
+__attribute__((target("avx2")))
+static void glyph_blend_row_avx2(uint32_t *dst, const uint8_t *mask, int n, uint32_t color) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c16 = _mm256_unpacklo_epi8(_mm256_set1_epi32(color), zero);
+    const __m256i v255 = _mm256_set1_epi16(255);
+    const __m256i v128 = _mm256_set1_epi16(128);
+    // Within each 128 bit lane, as in the SSE version, with pixels 4 to 7
+    // of the mask moved up to the second lane first
+    const __m256i spread_lo = _mm256_setr_epi8(0, -1, 0, -1, 0, -1, 0, -1, 1, -1, 1, -1, 1, -1, 1, -1,
+                                               4, -1, 4, -1, 4, -1, 4, -1, 5, -1, 5, -1, 5, -1, 5, -1);
+    const __m256i spread_hi = _mm256_setr_epi8(2, -1, 2, -1, 2, -1, 2, -1, 3, -1, 3, -1, 3, -1, 3, -1,
+                                               6, -1, 6, -1, 6, -1, 6, -1, 7, -1, 7, -1, 7, -1, 7, -1);
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        uint64_t m;
+        memcpy(&m, mask + i, 8);
+        if (m == 0) {
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+        __m256i mv = _mm256_broadcastq_epi64(_mm_cvtsi64_si128(m));
+        __m256i a_lo = _mm256_shuffle_epi8(mv, spread_lo);
+        __m256i a_hi = _mm256_shuffle_epi8(mv, spread_hi);
+        __m256i d_lo = _mm256_unpacklo_epi8(d, zero);
+        __m256i d_hi = _mm256_unpackhi_epi8(d, zero);
+        __m256i t_lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(c16, a_lo), _mm256_mullo_epi16(d_lo, _mm256_sub_epi16(v255, a_lo))), v128);
+        __m256i t_hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(c16, a_hi), _mm256_mullo_epi16(d_hi, _mm256_sub_epi16(v255, a_hi))), v128);
+        t_lo = _mm256_srli_epi16(_mm256_add_epi16(t_lo, _mm256_srli_epi16(t_lo, 8)), 8);
+        t_hi = _mm256_srli_epi16(_mm256_add_epi16(t_hi, _mm256_srli_epi16(t_hi, 8)), 8);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(t_lo, t_hi));
+    }
+    glyph_blend_row_scalar(dst + i, mask + i, n - i, color);
+}
+#endif
+
+typedef void (*glyph_blend_row_t)(uint32_t *, const uint8_t *, int, uint32_t);
+static glyph_blend_row_t glyph_blend_row = glyph_blend_row_scalar;
+static const char *glyph_blend_row_name = "scalar";
+
+// Pick the widest row blender this processor runs, DPTV_NO_SIMD in the
+// environment keeps the scalar one
+void init_glyph_blend() {
+#ifdef GLYPH_X86
+    __builtin_cpu_init();
+    if (getenv("DPTV_NO_SIMD") != NULL) {
+        return;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        glyph_blend_row = glyph_blend_row_avx2;
+        glyph_blend_row_name = "avx2";
+    } else if (__builtin_cpu_supports("ssse3")) {
+        glyph_blend_row = glyph_blend_row_ssse3;
+        glyph_blend_row_name = "ssse3";
+    }
+#endif
+}
+
+const char * glyph_blend_name() {
+    return glyph_blend_row_name;
+}
+
+// Tint a w x h coverage mask with color and blend it into dst at (x, y),
+// clipped to the clip rectangle of dst
+void glyph_blend_mask(SDL_Surface * dst, const uint8_t * mask, int w, int h, int x, int y, SDL_Color color) {
+    SDL_Rect *clip = &dst->clip_rect;
+    int x0 = (x > clip->x) ? x : clip->x;
+    int y0 = (y > clip->y) ? y : clip->y;
+    int x1 = (x + w < clip->x + clip->w) ? x + w : clip->x + clip->w;
+    int y1 = (y + h < clip->y + clip->h) ? y + h : clip->y + clip->h;
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    uint32_t c = SDL_MapRGBA(dst->format, color.r, color.g, color.b, 0xFF);
+    for(int row = y0; row < y1; row++) {
+        uint32_t *d = (uint32_t *)((uint8_t *)dst->pixels + row * dst->pitch) + x0;
+        glyph_blend_row(d, mask + (row - y) * w + (x0 - x), x1 - x0, c);
+    }
+}
@@ -0,0 +1,77 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _GLYPH_H_
+#define _GLYPH_H_
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Batch of glyph quads drawn from a single texture atlas. Characters are
+// queued with glyph_batch_add and submitted to the renderer with one
+// SDL_RenderGeometry call per flush.
+typedef struct glyph_batch_type {
+    SDL_Renderer *rend;
+    SDL_Texture *atlas;
+    int atlas_w;
+    int atlas_h;
+    SDL_Rect cells['~' - ' ' + 1];
+    SDL_Vertex *verts;
+    int *indices;
+    int n_quads;
+} glyph_batch_t;
+
+// The character surfaces stretched to one size ahead of time, so drawing a
+// character at that size is an unscaled blit. The coverage of each glyph is
+// also kept as one byte per pixel for glyph_blend_mask.
+typedef struct glyph_set_type {
+    int w;
+    int h;
+    SDL_Surface *glyphs['~' - ' ' + 1];
+    uint8_t *masks['~' - ' ' + 1];
+} glyph_set_t;
+
+glyph_batch_t * glyph_batch_new(SDL_Renderer *rend, SDL_Surface **char_surfs);
+void glyph_batch_free(glyph_batch_t *batch);
+void glyph_batch_add(glyph_batch_t *batch, char c, const SDL_Rect *dst, SDL_Color color);
+void glyph_batch_flush(glyph_batch_t *batch);
+glyph_set_t * glyph_set_new(SDL_Surface **char_surfs, int w, int h);
+void glyph_set_free(glyph_set_t *set);
+SDL_Surface * glyph_copy_surface(SDL_Surface *src);
+void init_glyph_blend();
+bool glyph_can_blend(SDL_Surface *dst);
+void glyph_blend_mask(SDL_Surface *dst, const uint8_t *mask, int w, int h, int x, int y, SDL_Color color);
+const char * glyph_blend_name();
+
+#endif
@@ -40,7 +40,7 @@
 
 // Help Text
 int help_page = 0;
-const int num_help_pages = 7;
+const int num_help_pages = 8;
 const char*** help_text = (const char**[]){
 (const char*[]){
 "  ==== Dual Pipetrace Viewer ====",
@@ -101,6 +101,25 @@ const char*** help_text = (const char**[]){
 "shift the second trace",
 ""},
 (const char*[]){
+"         Trace Alignment",
+" ",
+"When two traces are loaded, their",
+"instructions are aligned so that",
+"the same committed instructions",
+"share a row. Squashed instructions",
+"are padded with empty rows",
+" ",
+"If the alignment looks wrong in",
+"some region, hover over an",
+"instruction there and press m to",
+"re-align the nearby rows, using",
+"that instruction as the anchor",
+" ",
+"Press ] or [ to jump to the next",
+"or previous region where the",
+"traces diverge",
+""},
+(const char*[]){
 "          Basic Searching",
 " ",
 "Press / to begin searching",
@@ -163,6 +182,14 @@ const char*** help_text = (const char**[]){
 " ",
 "Press P (upper case) to toggle",
 "continual snapping",
+" ",
+"Press f to toggle frame times in",
+"the command bar",
+" ",
+"Press o to cycle the overview",
+"strip between IPC, time in the",
+"pipeline, and hidden. Click it",
+"to jump there",
 ""
 }};
 
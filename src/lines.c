@@ -0,0 +1,171 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "lines.h"
+
+// Farthest a point is placed off the surface, beyond this SDL's integer
+// coordinates could overflow
+static const int64_t line_max_px = 1 << 24;
+
+static void push_point(line_strip_t *, int64_t, int64_t, bool);
+static int clamp_px(int64_t);
+
+void line_strip_clear(line_strip_t * strip) {
+    strip->n = 0;
+    strip->have_row = false;
+    strip->gap = false;
+}
+
+// Add the stage of one instruction, drawn on pixel row y. Rows must be added
+// in increasing order.
+void line_strip_add(line_strip_t * strip, int64_t x, int64_t y) {
+    if (strip->have_row && y != strip->row_y) {
+        line_strip_end(strip);
+    }
+    if (!strip->have_row) {
+        strip->have_row = true;
+        strip->row_y = y;
+        strip->row_min = x;
+        strip->row_max = x;
+        strip->row_bright = !strip->gap;
+        strip->gap = false;
+        return;
+    }
+    if (x < strip->row_min) strip->row_min = x;
+    if (x > strip->row_max) strip->row_max = x;
+}
+
+// An instruction without the stage, the next segment is drawn dimmed
+void line_strip_skip(line_strip_t * strip) {
+    strip->gap = true;
+}
+
+// Finish the pixel row being collected
+void line_strip_end(line_strip_t * strip) {
+    if (!strip->have_row) {
+        return;
+    }
+    strip->have_row = false;
+    int64_t a = strip->row_min;
+    int64_t b = strip->row_max;
+    // Start from whichever end is closer to the last point so the strip
+    // doesn't cross itself
+    if (strip->n > 0 && llabs(strip->points[strip->n-1].x - b) < llabs(strip->points[strip->n-1].x - a)) {
+        a = strip->row_max;
+        b = strip->row_min;
+    }
+    push_point(strip, a, strip->row_y, strip->row_bright);
+    if (b != a) {
+        push_point(strip, b, strip->row_y, true);
+    }
+}
+
+// Draw the part of the strip between world pixel rows y0 and y1, with one
+// polyline for the solid runs and one dimmed underneath if there are gaps
+void line_strip_draw(line_strip_t * strip, SDL_Renderer * rend, SDL_Color color, int64_t cam_x, int64_t cam_y, int64_t y0, int64_t y1) {
+    if (strip->n == 0) {
+        return;
+    }
+    // First point at or below y0, stepping back one to take in the segment
+    // coming into the rows
+    uint64_t lo = 0;
+    uint64_t hi = strip->n;
+    while(lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (strip->points[mid].y < y0) lo = mid + 1;
+        else                          hi = mid;
+    }
+    uint64_t first = (lo > 0) ? lo - 1 : 0;
+    uint64_t last = first;
+    while(last + 1 < strip->n && strip->points[last].y < y1) {
+        last ++;
+    }
+    uint64_t n = last - first + 1;
+    if (n < 2) {
+        return;
+    }
+    SDL_Point *pts = malloc(sizeof(SDL_Point) * n);
+    assert(pts);
+    bool any_dim = false;
+    for(uint64_t i = 0; i < n; i++) {
+        line_point_t *p = &strip->points[first + i];
+        pts[i] = (SDL_Point){clamp_px(p->x - cam_x), clamp_px(p->y - cam_y)};
+        if (i > 0 && !p->bright) any_dim = true;
+    }
+    if (!any_dim) {
+        SDL_SetRenderDrawColor(rend, color.r, color.g, color.b, 0xFF);
+        SDL_RenderDrawLines(rend, pts, n);
+    } else {
+        SDL_SetRenderDrawColor(rend, color.r / 3, color.g / 3, color.b / 3, 0xFF);
+        SDL_RenderDrawLines(rend, pts, n);
+        SDL_SetRenderDrawColor(rend, color.r, color.g, color.b, 0xFF);
+        uint64_t start = 0;
+        for(uint64_t i = 1; i <= n; i++) {
+            if (i == n || !strip->points[first + i].bright) {
+                if (i - start > 1) {
+                    SDL_RenderDrawLines(rend, &pts[start], i - start);
+                }
+                start = i;
+            }
+        }
+    }
+    free(pts);
+}
+
+void line_strip_free(line_strip_t * strip) {
+    free(strip->points);
+    strip->points = NULL;
+    strip->n = 0;
+    strip->size = 0;
+}
+
+static void push_point(line_strip_t * strip, int64_t x, int64_t y, bool bright) {
+    if (strip->n >= strip->size) {
+        strip->size = (strip->size == 0) ? 1024 : strip->size * 2;
+        strip->points = realloc(strip->points, sizeof(line_point_t) * strip->size);
+        assert(strip->points);
+    }
+    strip->points[strip->n] = (line_point_t){x, y, bright};
+    strip->n ++;
+}
+
+static int clamp_px(int64_t v) {
+    if (v < -line_max_px) return -line_max_px;
+    if (v > line_max_px) return line_max_px;
+    return v;
+}
@@ -0,0 +1,87 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _LINES_H_
+#define _LINES_H_
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Point of a line in world pixels, see gfx_world_to_px. bright is set when
+// the segment from the point before is drawn at full color, and clear when
+// an instruction without the stage came between them.
+typedef struct line_point_type {
+    int64_t x;
+    int64_t y;
+    bool bright;
+} line_point_t;
+
+// Line through one stage of every instruction of a trace, reduced to the
+// leftmost and rightmost hit on each pixel row
+typedef struct line_strip_type {
+    line_point_t *points;
+    uint64_t n;
+    uint64_t size;
+    // Pixel row being collected
+    bool have_row;
+    int64_t row_y;
+    int64_t row_min;
+    int64_t row_max;
+    bool row_bright;
+    bool gap;
+} line_strip_t;
+
+// Strips of one trace for the zoom they were built at, covering world pixel
+// rows y0 up to y1
+typedef struct line_cache_type {
+    double scale;
+    double trace_scale;
+    int off;
+    int focus;
+    uint64_t gen;
+    int64_t y0;
+    int64_t y1;
+    int n_strips;
+    line_strip_t *strips;
+} line_cache_t;
+
+void line_strip_clear(line_strip_t *strip);
+void line_strip_add(line_strip_t *strip, int64_t x, int64_t y);
+void line_strip_skip(line_strip_t *strip);
+void line_strip_end(line_strip_t *strip);
+void line_strip_draw(line_strip_t *strip, SDL_Renderer *rend, SDL_Color color, int64_t cam_x, int64_t cam_y, int64_t y0, int64_t y1);
+void line_strip_free(line_strip_t *strip);
+
+#endif
@@ -0,0 +1,462 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "dptv.h"
+#include "options.h"
+#include "trace_handler.h"
+#include "lod.h"
+
+const int lod_min_shift = 2;
+// Cycle buckets are this many times (as a shift) wider than row buckets. At
+// the zoom a level is drawn at, with two traces and a font half as wide as
+// it is tall, that is about a pixel each way.
+static const int lod_cycle_extra = 2;
+// Widest cycle range a block may cover, in buckets, so that one stray
+// instruction cannot blow up the size of a level
+static const uint64_t lod_max_span = 1 << 16;
+
+uint32_t lod_ready_event = 0;
+
+static lod_t **LODS = NULL;
+static int n_lods = 0;
+static SDL_Thread *lod_thread = NULL;
+static SDL_atomic_t lod_ready;
+static SDL_atomic_t lod_cancel;
+
+static int lod_build_thread(void *);
+static void size_base_level(trace_t *, lod_level_t *, int);
+static uint64_t size_base_block(trace_t *, lod_level_t *, uint64_t, uint64_t *);
+static bool fill_base_level(trace_t *, lod_level_t *);
+static void fill_base_rows(trace_t *, lod_level_t *, uint64_t, uint64_t);
+static bool build_next_level(lod_level_t *, lod_level_t *);
+static uint64_t size_next_block(lod_level_t *, uint64_t, uint64_t *);
+static void fill_next_block(lod_level_t *, lod_level_t *, uint64_t);
+static bool resize_blocks(lod_level_t *, uint64_t, uint64_t, uint64_t *, uint64_t *);
+static bool splice_trace_lod(lod_t *, trace_t *, uint64_t, uint64_t);
+
+// Build every level of the pyramid for one trace. Returns NULL if cancel is
+// set part way through, or if there isn't the memory for it.
+lod_t * build_lod(trace_t * trace, SDL_atomic_t * cancel) {
+    lod_t *lod = malloc(sizeof(lod_t));
+    assert(lod);
+    // Skip the finest levels until the pyramid fits in this trace's share of
+    // -lodmem, the levels above the first add about a third again. Views
+    // zoomed in past the first level are drawn from the instructions.
+    uint64_t cap = ((uint64_t)OPTIONS->lod_mem << 20) / OPTIONS->num_traces;
+    lod_level_t base;
+    int shift = lod_min_shift;
+    while (true) {
+        size_base_level(trace, &base, shift);
+        uint64_t bytes = base.offset[base.n_blocks] * sizeof(lod_cell_t) * 4 / 3 + base.n_blocks * sizeof(uint64_t) * 4;
+        if (bytes <= cap || base.n_blocks <= 1) {
+            break;
+        }
+        free(base.first);
+        free(base.offset);
+        shift ++;
+    }
+    // Halve the rows per level until a single block is left
+    int n_levels = 1;
+    while (trace->n_insts > ((uint64_t)1 << (shift + n_levels - 1))) {
+        n_levels ++;
+    }
+    lod->levels = malloc(sizeof(lod_level_t) * n_levels);
+    assert(lod->levels);
+    lod->n_rows = trace->n_insts;
+    lod->levels[0] = base;
+    lod->n_levels = 1;
+    if (!fill_base_level(trace, &lod->levels[0])) {
+        free_lod(lod);
+        return NULL;
+    }
+    for(int i = 1; i < n_levels; i++) {
+        if (SDL_AtomicGet(cancel)) {
+            free_lod(lod);
+            return NULL;
+        }
+        lod->n_levels ++;
+        if (!build_next_level(&lod->levels[i-1], &lod->levels[i])) {
+            free_lod(lod);
+            return NULL;
+        }
+    }
+    return lod;
+}
+
+void free_lod(lod_t * lod) {
+    if (lod == NULL) {
+        return;
+    }
+    for(int i = 0; i < lod->n_levels; i++) {
+        free(lod->levels[i].first);
+        free(lod->levels[i].offset);
+        free(lod->levels[i].cells);
+    }
+    free(lod->levels);
+    free(lod);
+}
+
+// Start building the pyramids of all traces in the background, throwing away
+// any earlier ones
+void start_lod_build() {
+    stop_lod_build();
+    for(int t = 0; t < n_lods; t++) {
+        free_lod(LODS[t]);
+    }
+    free(LODS);
+    n_lods = OPTIONS->num_traces;
+    LODS = calloc(n_lods, sizeof(lod_t *));
+    assert(LODS);
+    if (lod_ready_event == 0) {
+        lod_ready_event = SDL_RegisterEvents(1);
+    }
+    SDL_AtomicSet(&lod_ready, 0);
+    SDL_AtomicSet(&lod_cancel, 0);
+    lod_thread = SDL_CreateThread(lod_build_thread, "lod", NULL);
+    if (lod_thread == NULL) {
+        fprintf(stderr, "lod: failed to start build thread. %s\n", SDL_GetError());
+    }
+}
+
+// Cancel a build in progress and wait for it, needed before the rows of the
+// traces are changed
+void stop_lod_build() {
+    if (lod_thread != NULL) {
+        SDL_AtomicSet(&lod_cancel, 1);
+        SDL_WaitThread(lod_thread, NULL);
+        lod_thread = NULL;
+    }
+}
+
+// Wait for a build in progress to finish, for drawing without an event loop
+void wait_lod_build() {
+    if (lod_thread != NULL) {
+        SDL_WaitThread(lod_thread, NULL);
+        lod_thread = NULL;
+    }
+}
+
+// Level with the given shift, or the coarsest there is. NULL until the
+// background build has finished.
+lod_level_t * get_lod_level(int trace, int shift) {
+    if (LODS == NULL || SDL_AtomicGet(&lod_ready) == 0 || trace >= n_lods || shift < lod_min_shift) {
+        return NULL;
+    }
+    lod_t *lod = LODS[trace];
+    int i = shift - lod->levels[0].shift;
+    if (i < 0) return NULL;
+    if (i >= lod->n_levels) i = lod->n_levels - 1;
+    return &lod->levels[i];
+}
+
+// Rows [r0, r1) were replaced by n_rows rows, with the build stopped first.
+// Where the pyramids are built and the rows below haven't moved, only the
+// blocks over the window are redone, otherwise they are built again.
+void splice_lod(uint64_t r0, uint64_t r1, uint64_t n_rows) {
+    bool done = LODS != NULL && SDL_AtomicGet(&lod_ready) != 0 && n_rows == r1 - r0;
+    for(int t = 0; t < n_lods && done; t++) {
+        done = TRACES[t]->n_insts == LODS[t]->n_rows && splice_trace_lod(LODS[t], TRACES[t], r0, r1);
+    }
+    if (!done) {
+        start_lod_build();
+    }
+}
+
+static bool splice_trace_lod(lod_t * lod, trace_t * trace, uint64_t r0, uint64_t r1) {
+    if (r1 > trace->n_insts) r1 = trace->n_insts;
+    if (r0 >= r1) {
+        return true;
+    }
+    lod_level_t *level = &lod->levels[0];
+    uint64_t b0 = r0 >> level->shift;
+    uint64_t b1 = ((r1 - 1) >> level->shift) + 1;
+    uint64_t *first = malloc(sizeof(uint64_t) * (b1 - b0));
+    uint64_t *span = malloc(sizeof(uint64_t) * (b1 - b0));
+    assert(first && span);
+    bool ok = true;
+    for(int i = 0; i < lod->n_levels && ok; i++) {
+        level = &lod->levels[i];
+        // Each level up covers the blocks below it two at a time
+        if (i > 0) {
+            b0 >>= 1;
+            b1 = (b1 + 1) >> 1;
+        }
+        for(uint64_t b = b0; b < b1; b++) {
+            if (i == 0) span[b - b0] = size_base_block(trace, level, b, &first[b - b0]);
+            else        span[b - b0] = size_next_block(&lod->levels[i-1], b, &first[b - b0]);
+        }
+        ok = resize_blocks(level, b0, b1, first, span);
+        if (!ok) {
+            break;
+        }
+        if (i == 0) {
+            uint64_t end = b1 << level->shift;
+            fill_base_rows(trace, level, b0 << level->shift, (end < trace->n_insts) ? end : trace->n_insts);
+        } else {
+            for(uint64_t b = b0; b < b1; b++) {
+                fill_next_block(&lod->levels[i-1], level, b);
+            }
+        }
+    }
+    free(first);
+    free(span);
+    return ok;
+}
+
+static int lod_build_thread(void * data) {
+    uint32_t start = SDL_GetTicks();
+    for(int t = 0; t < n_lods; t++) {
+        LODS[t] = build_lod(TRACES[t], &lod_cancel);
+        if (LODS[t] == NULL) {
+            if (!SDL_AtomicGet(&lod_cancel)) {
+                fprintf(stderr, "lod: out of memory, drawing without the pyramid\n");
+            }
+            return 0;
+        }
+    }
+    SDL_AtomicSet(&lod_ready, 1);
+    printf("built level of detail pyramid in %" PRIu32 " ms\n", SDL_GetTicks() - start);
+    fflush(stdout);
+    // Wake the event loop so the view is redrawn from the pyramid
+    if (lod_ready_event != (uint32_t)-1) {
+        SDL_Event e;
+        memset(&e, 0, sizeof(e));
+        e.type = lod_ready_event;
+        SDL_PushEvent(&e);
+    }
+    return 0;
+}
+
+// First and last cycle an instruction is in the pipeline, and the cycle it
+// commits in (0 if squashed)
+bool inst_span(instruction_t * inst, uint64_t * lo, uint64_t * hi, uint64_t * commit) {
+    if (!inst->valid || inst->n_stages == 0) {
+        return false;
+    }
+    *lo = inst->stages[0].cycle;
+    *hi = *lo;
+    *commit = 0;
+    for(uint32_t s = 0; s < inst->n_stages; s++) {
+        uint64_t c = inst->stages[s].cycle;
+        if (c < *lo) *lo = c;
+        if (c > *hi) *hi = c;
+    }
+    if (inst->committed) {
+        *commit = *hi;
+        for(uint32_t s = 0; s < inst->n_stages; s++) {
+            if (inst->stages[s].name != NULL && strcmp(inst->stages[s].name, OPTIONS->commit_stage) == 0) {
+                *commit = inst->stages[s].cycle;
+            }
+        }
+    }
+    return true;
+}
+
+// Block layout of the first level, without its cells
+static void size_base_level(trace_t * trace, lod_level_t * level, int shift) {
+    int cshift = shift + lod_cycle_extra;
+    uint64_t size = (uint64_t)1 << shift;
+    level->shift = shift;
+    level->cycle_shift = cshift;
+    level->n_blocks = (trace->n_insts + size - 1) >> shift;
+    level->first = malloc(sizeof(uint64_t) * (level->n_blocks + 1));
+    level->offset = malloc(sizeof(uint64_t) * (level->n_blocks + 1));
+    level->cells = NULL;
+    assert(level->first && level->offset);
+
+    // Cycle range of each block
+    uint64_t total = 0;
+    for(uint64_t b = 0; b < level->n_blocks; b++) {
+        level->offset[b] = total;
+        total += size_base_block(trace, level, b, &level->first[b]);
+    }
+    level->offset[level->n_blocks] = total;
+}
+
+// First cycle bucket of a block of the first level, returning how many
+// buckets it covers
+static uint64_t size_base_block(trace_t * trace, lod_level_t * level, uint64_t b, uint64_t * first) {
+    int shift = level->shift;
+    int cshift = level->cycle_shift;
+    uint64_t b_lo = UINT64_MAX;
+    uint64_t b_hi = 0;
+    for(uint64_t r = b << shift; r < ((b + 1) << shift) && r < trace->n_insts; r++) {
+        uint64_t lo, hi, commit;
+        if (inst_span(&trace->insts[r], &lo, &hi, &commit)) {
+            if (lo < b_lo) b_lo = lo;
+            if (hi > b_hi) b_hi = hi;
+        }
+    }
+    *first = 0;
+    if (b_lo == UINT64_MAX) {
+        return 0;
+    }
+    uint64_t span = (b_hi >> cshift) - (b_lo >> cshift) + 1;
+    *first = b_lo >> cshift;
+    return (span > lod_max_span) ? lod_max_span : span;
+}
+
+static bool fill_base_level(trace_t * trace, lod_level_t * level) {
+    level->cells = calloc(level->offset[level->n_blocks] + 1, sizeof(lod_cell_t));
+    if (level->cells == NULL) {
+        return false;
+    }
+    fill_base_rows(trace, level, 0, trace->n_insts);
+    return true;
+}
+
+// Spread each instruction of rows [r0, r1) over the buckets it covers
+static void fill_base_rows(trace_t * trace, lod_level_t * level, uint64_t r0, uint64_t r1) {
+    int shift = level->shift;
+    int cshift = level->cycle_shift;
+    uint64_t csize = (uint64_t)1 << cshift;
+    for(uint64_t r = r0; r < r1; r++) {
+        uint64_t lo, hi, commit;
+        if (!inst_span(&trace->insts[r], &lo, &hi, &commit)) {
+            continue;
+        }
+        uint64_t b = r >> shift;
+        lod_cell_t *cells = &level->cells[level->offset[b]];
+        uint64_t n = level->offset[b+1] - level->offset[b];
+        uint64_t first = level->first[b];
+        for(uint64_t k = lo >> cshift; k <= (hi >> cshift) && k - first < n; k++) {
+            uint64_t c0 = k << cshift;
+            uint64_t c1 = c0 + csize - 1;
+            uint64_t from = (lo > c0) ? lo : c0;
+            uint64_t to = (hi < c1) ? hi : c1;
+            cells[k - first].occ += to - from + 1;
+        }
+        if ((lo >> cshift) - first < n) {
+            cells[(lo >> cshift) - first].fetch ++;
+        }
+        if (commit != 0 && (commit >> cshift) - first < n) {
+            cells[(commit >> cshift) - first].commit ++;
+        }
+    }
+}
+
+static bool build_next_level(lod_level_t * child, lod_level_t * level) {
+    // Each block and bucket covers two of the level below
+    level->shift = child->shift + 1;
+    level->cycle_shift = child->cycle_shift + 1;
+    level->cells = NULL;
+    level->n_blocks = (child->n_blocks + 1) / 2;
+    level->first = malloc(sizeof(uint64_t) * (level->n_blocks + 1));
+    level->offset = malloc(sizeof(uint64_t) * (level->n_blocks + 1));
+    assert(level->first && level->offset);
+
+    uint64_t total = 0;
+    for(uint64_t b = 0; b < level->n_blocks; b++) {
+        level->offset[b] = total;
+        total += size_next_block(child, b, &level->first[b]);
+    }
+    level->offset[level->n_blocks] = total;
+    level->cells = calloc(total + 1, sizeof(lod_cell_t));
+    if (level->cells == NULL) {
+        return false;
+    }
+    for(uint64_t b = 0; b < level->n_blocks; b++) {
+        fill_next_block(child, level, b);
+    }
+    return true;
+}
+
+// First cycle bucket of a block above the first level, returning how many
+// buckets it covers
+static uint64_t size_next_block(lod_level_t * child, uint64_t b, uint64_t * first) {
+    uint64_t lo = UINT64_MAX;
+    uint64_t hi = 0;
+    for(uint64_t c = 2*b; c < 2*b + 2 && c < child->n_blocks; c++) {
+        uint64_t n = child->offset[c+1] - child->offset[c];
+        if (n == 0) continue;
+        if ((child->first[c] >> 1) < lo) lo = child->first[c] >> 1;
+        if (((child->first[c] + n - 1) >> 1) > hi) hi = (child->first[c] + n - 1) >> 1;
+    }
+    *first = 0;
+    if (lo == UINT64_MAX) {
+        return 0;
+    }
+    *first = lo;
+    return hi - lo + 1;
+}
+
+static void fill_next_block(lod_level_t * child, lod_level_t * level, uint64_t b) {
+    lod_cell_t *cells = &level->cells[level->offset[b]];
+    for(uint64_t c = 2*b; c < 2*b + 2 && c < child->n_blocks; c++) {
+        for(uint64_t k = child->offset[c]; k < child->offset[c+1]; k++) {
+            lod_cell_t *from = &child->cells[k];
+            lod_cell_t *to = &cells[((child->first[c] + k - child->offset[c]) >> 1) - level->first[b]];
+            to->occ += from->occ;
+            to->fetch += from->fetch;
+            to->commit += from->commit;
+        }
+    }
+}
+
+// Give blocks [b0, b1) of a level the given cycle ranges, with their cells
+// cleared, moving the cells of the blocks after them
+static bool resize_blocks(lod_level_t * level, uint64_t b0, uint64_t b1, uint64_t * first, uint64_t * span) {
+    uint64_t total = 0;
+    for(uint64_t b = b0; b < b1; b++) {
+        total += span[b - b0];
+    }
+    uint64_t old_total = level->offset[level->n_blocks];
+    uint64_t start = level->offset[b0];
+    uint64_t old_end = level->offset[b1];
+    uint64_t n_cells = old_total - (old_end - start) + total;
+    if (n_cells > old_total) {
+        lod_cell_t *cells = realloc(level->cells, sizeof(lod_cell_t) * (n_cells + 1));
+        if (cells == NULL) {
+            return false;
+        }
+        level->cells = cells;
+    }
+    memmove(&level->cells[start + total], &level->cells[old_end], sizeof(lod_cell_t) * (old_total - old_end));
+    memset(&level->cells[start], 0, sizeof(lod_cell_t) * total);
+    uint64_t offset = start;
+    for(uint64_t b = b0; b < b1; b++) {
+        level->offset[b] = offset;
+        level->first[b] = first[b - b0];
+        offset += span[b - b0];
+    }
+    for(uint64_t b = b1; b <= level->n_blocks; b++) {
+        level->offset[b] = level->offset[b] - old_end + offset;
+    }
+    return true;
+}
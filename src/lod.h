@@ -0,0 +1,82 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _LOD_H_
+#define _LOD_H_
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "dptv.h"
+
+// Totals for one block of rows over one block of cycles
+typedef struct lod_cell_type {
+    uint32_t occ;       // cycles spent in the pipeline by the rows
+    uint32_t fetch;     // rows fetched in these cycles
+    uint32_t commit;    // rows committed in these cycles
+} lod_cell_t;
+
+// One level of the pyramid, where each cell covers 1<<shift rows by
+// 1<<cycle_shift cycles. Block b holds the cells for its rows, starting at
+// cycle bucket first[b], stored at cells[offset[b]] up to cells[offset[b+1]].
+typedef struct lod_level_type {
+    int shift;
+    int cycle_shift;
+    uint64_t n_blocks;
+    uint64_t *first;
+    uint64_t *offset;
+    lod_cell_t *cells;
+} lod_level_t;
+
+typedef struct lod_type {
+    lod_level_t *levels;
+    int n_levels;
+    uint64_t n_rows;        // rows of the trace it was built over
+} lod_t;
+
+lod_t * build_lod(trace_t *trace, SDL_atomic_t *cancel);
+void free_lod(lod_t *lod);
+void start_lod_build();
+void stop_lod_build();
+void wait_lod_build();
+void splice_lod(uint64_t r0, uint64_t r1, uint64_t n_rows);
+lod_level_t * get_lod_level(int trace, int shift);
+bool inst_span(instruction_t *inst, uint64_t *lo, uint64_t *hi, uint64_t *commit);
+
+// Smallest level kept, finer views are drawn from the instructions
+extern const int lod_min_shift;
+// Event pushed once the pyramids are ready to draw from
+extern uint32_t lod_ready_event;
+
+#endif
@@ -0,0 +1,196 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "dptv.h"
+#include "options.h"
+#include "trace_handler.h"
+#include "lod.h"
+#include "pool.h"
+#include "minimap.h"
+
+minimap_t *MINIMAP = NULL;
+
+// Buckets per trace, more than the strip has pixel rows on any screen
+static const int minimap_buckets = 4096;
+// Fraction of buckets below the value shaded brightest, so that a few
+// extreme buckets don't leave the rest dark
+static const double minimap_full_pct = 0.99;
+
+static void scale_minimap(minimap_t *);
+static int bucket_of(minimap_t *, uint64_t);
+static int cmp_double(const void *, const void *);
+
+
+// Total up every trace once, in parallel, for the overview strip
+void build_minimap() {
+    free_minimap();
+    minimap_t *m = calloc(1, sizeof(minimap_t));
+    assert(m);
+    m->n_traces = OPTIONS->num_traces;
+    for(int t = 0; t < m->n_traces; t++) {
+        if (TRACES[t]->n_insts > m->n_rows) m->n_rows = TRACES[t]->n_insts;
+    }
+    m->n_buckets = (m->n_rows < (uint64_t)minimap_buckets) ? (int)m->n_rows : minimap_buckets;
+    if (m->n_buckets == 0) {
+        free(m);
+        return;
+    }
+    int n = m->n_traces * m->n_buckets;
+    m->buckets = calloc(n, sizeof(minimap_bucket_t));
+    assert(m->buckets);
+    pool_for(minimap_job, m, n);
+    MINIMAP = m;
+    scale_minimap(m);
+}
+
+// Rows [r0, r1) were replaced by n_rows rows. Unless the rows below moved,
+// only the buckets over the window are totalled again.
+void splice_minimap(uint64_t r0, uint64_t r1, uint64_t n_rows) {
+    minimap_t *m = MINIMAP;
+    uint64_t rows = 0;
+    for(int t = 0; t < OPTIONS->num_traces; t++) {
+        if (TRACES[t]->n_insts > rows) rows = TRACES[t]->n_insts;
+    }
+    if (m == NULL || rows != m->n_rows || n_rows != r1 - r0 || r0 >= r1) {
+        build_minimap();
+        return;
+    }
+    int b0 = bucket_of(m, r0);
+    int b1 = bucket_of(m, r1 - 1);
+    for(int t = 0; t < m->n_traces; t++) {
+        for(int b = b0; b <= b1; b++) {
+            int i = t * m->n_buckets + b;
+            memset(&m->buckets[i], 0, sizeof(minimap_bucket_t));
+            minimap_job(m, i);
+        }
+    }
+    scale_minimap(m);
+}
+
+// Bucket holding a row
+static int bucket_of(minimap_t * m, uint64_t row) {
+    int b = row * m->n_buckets / m->n_rows;
+    while (b + 1 < m->n_buckets && (b + 1) * m->n_rows / m->n_buckets <= row) b ++;
+    while (b > 0 && b * m->n_rows / m->n_buckets > row) b --;
+    return b;
+}
+
+static void scale_minimap(minimap_t * m) {
+    // Scale each mode to the buckets with instructions in them
+    int n = m->n_traces * m->n_buckets;
+    double *v = malloc(sizeof(double) * n);
+    assert(v);
+    for(int mode = 0; mode < MINIMAP_MODES; mode++) {
+        int k = 0;
+        for(int t = 0; t < m->n_traces; t++) {
+            for(int b = 0; b < m->n_buckets; b++) {
+                if (m->buckets[t * m->n_buckets + b].n > 0) {
+                    v[k++] = minimap_value(t, b, mode);
+                }
+            }
+        }
+        m->full[mode] = 0;
+        if (k > 0) {
+            qsort(v, k, sizeof(double), cmp_double);
+            m->full[mode] = v[(int)((k - 1) * minimap_full_pct)];
+        }
+    }
+    free(v);
+}
+
+void minimap_job(void *arg, int index) {
+    minimap_t *m = (minimap_t *)arg;
+    int t = index / m->n_buckets;
+    int b = index % m->n_buckets;
+    minimap_bucket_t *bk = &m->buckets[index];
+    trace_t *trace = TRACES[t];
+    uint64_t r0 = b * m->n_rows / m->n_buckets;
+    uint64_t r1 = (b + 1) * m->n_rows / m->n_buckets;
+    if (r1 > trace->n_insts) r1 = trace->n_insts;
+    for(uint64_t r = r0; r < r1; r++) {
+        uint64_t lo, hi, commit;
+        if (!inst_span(&trace->insts[r], &lo, &hi, &commit)) {
+            continue;
+        }
+        bk->n ++;
+        bk->lat_sum += hi - lo;
+        if (trace->insts[r].committed) {
+            if (bk->n_commit == 0 || commit < bk->commit_first) bk->commit_first = commit;
+            if (bk->n_commit == 0 || commit > bk->commit_last) bk->commit_last = commit;
+            bk->n_commit ++;
+        }
+    }
+}
+
+void free_minimap() {
+    if (MINIMAP == NULL) return;
+    free(MINIMAP->buckets);
+    free(MINIMAP);
+    MINIMAP = NULL;
+}
+
+// Committed instructions per cycle, or average cycles in the pipeline, of a
+// bucket
+double minimap_value(int trace, int bucket, int mode) {
+    minimap_bucket_t *bk = &MINIMAP->buckets[trace * MINIMAP->n_buckets + bucket];
+    if (mode == MINIMAP_IPC) {
+        if (bk->n_commit == 0) return 0;
+        return (double)bk->n_commit / (bk->commit_last - bk->commit_first + 1);
+    }
+    if (bk->n == 0) return 0;
+    return (double)bk->lat_sum / bk->n;
+}
+
+// Value of a bucket from 0 to 1 against the brightest, or -1 if it has no
+// instructions
+double minimap_shade(int trace, int bucket, int mode) {
+    if (MINIMAP->buckets[trace * MINIMAP->n_buckets + bucket].n == 0) {
+        return -1;
+    }
+    if (MINIMAP->full[mode] <= 0) {
+        return 0;
+    }
+    double f = minimap_value(trace, bucket, mode) / MINIMAP->full[mode];
+    return (f > 1) ? 1 : f;
+}
+
+static int cmp_double(const void * a, const void * b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
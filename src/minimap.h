@@ -0,0 +1,76 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _MINIMAP_H_
+#define _MINIMAP_H_
+
+#include <stdint.h>
+#include "dptv.h"
+
+// What the overview strip shades each bucket by
+#define MINIMAP_IPC        0
+#define MINIMAP_LATENCY    1
+#define MINIMAP_MODES      2
+
+// Totals for one bucket of consecutive instructions of a trace
+typedef struct minimap_bucket_type {
+    uint64_t n;             // instructions with stages
+    uint64_t n_commit;      // of those, committed
+    uint64_t commit_first;  // earliest and latest commit cycle
+    uint64_t commit_last;
+    uint64_t lat_sum;       // cycles from first to last stage, summed
+} minimap_bucket_t;
+
+// The whole of every trace split into n_buckets buckets of rows. Bucket b of
+// trace t covers rows [b * n_rows / n_buckets, (b + 1) * n_rows / n_buckets)
+// and is stored at buckets[t * n_buckets + b].
+typedef struct minimap_type {
+    int n_traces;
+    uint64_t n_rows;
+    int n_buckets;
+    minimap_bucket_t *buckets;
+    // Value shaded brightest for each mode
+    double full[MINIMAP_MODES];
+} minimap_t;
+
+void build_minimap();
+void splice_minimap(uint64_t r0, uint64_t r1, uint64_t n_rows);
+void free_minimap();
+void minimap_job(void *arg, int index);
+double minimap_value(int trace, int bucket, int mode);
+double minimap_shade(int trace, int bucket, int mode);
+
+extern minimap_t *MINIMAP;
+
+#endif
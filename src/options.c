@@ -90,6 +90,20 @@ static void init_options() {
     OPTIONS->trace_remove_squash = 0;
     OPTIONS->trace_disable_dummy = 0;
     OPTIONS->trace_disable_cutoff = 0;
+    OPTIONS->warp = 0;
+    OPTIONS->no_sidecar = 0;
+    OPTIONS->glyph_atlas = 0;
+    OPTIONS->glyph_bench = 0;
+    OPTIONS->headless = 0;
+    OPTIONS->export_script = NULL;
+    OPTIONS->frame_log = NULL;
+    OPTIONS->bench_passes = 0;
+    OPTIONS->threads = 0;
+    OPTIONS->tile_mem = 256;
+    OPTIONS->lod_mem = 256;
+    OPTIONS->search_mem = 256;
+    OPTIONS->side_rows = 1024;
+    OPTIONS->refine_ms = 50;
     OPTIONS->arg_command = NULL;
     OPTIONS->instr_window_width = 0;
 
@@ -308,6 +322,47 @@ int process_cmd_line(int argc, char *argv[]){
             else if (strcmp(argv[i],"-dcutoff") == 0 || strcmp(argv[i],"-dc") == 0) {
                 OPTIONS->trace_disable_cutoff = true;
             }
+            else if (strcmp(argv[i],"-warp") == 0 || strcmp(argv[i],"-wp") == 0) {
+                OPTIONS->warp = true;
+            }
+            else if (strcmp(argv[i],"-nosidecar") == 0 || strcmp(argv[i],"-ns") == 0) {
+                OPTIONS->no_sidecar = true;
+            }
+            else if (strcmp(argv[i],"-atlas") == 0 || strcmp(argv[i],"-at") == 0) {
+                OPTIONS->glyph_atlas = true;
+            }
+            else if (strcmp(argv[i],"-export") == 0 || strcmp(argv[i],"-ex") == 0) {
+                if ((i+1)>=argc) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->export_script = argv[i+1];
+                OPTIONS->headless = true;
+                ++i;
+            }
+            else if (strcmp(argv[i],"-framelog") == 0 || strcmp(argv[i],"-fl") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->frame_log = argv[i+1];
+                ++i;
+            }
+            else if (strcmp(argv[i],"-benchrender") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->bench_passes = strtol(argv[i+1], NULL, 10);
+                OPTIONS->headless = true;
+                ++i;
+            }
+            else if (strcmp(argv[i],"-glyphbench") == 0) {
+                OPTIONS->glyph_bench = true;
+            }
             else if (strcmp(argv[i],"-fontfile") == 0 || strcmp(argv[i],"-ff") == 0) {
                 if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
                     cmd_err_idx = i;
@@ -329,6 +384,60 @@ int process_cmd_line(int argc, char *argv[]){
                 OPTIONS->instr_window_width = strtol(argv[i+1], NULL, 10);
                 ++i;
             }
+            else if (strcmp(argv[i],"-threads") == 0 || strcmp(argv[i],"-j") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->threads = strtol(argv[i+1], NULL, 10);
+                ++i;
+            }
+            else if (strcmp(argv[i],"-tilemem") == 0 || strcmp(argv[i],"-tm") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->tile_mem = strtol(argv[i+1], NULL, 10);
+                ++i;
+            }
+            else if (strcmp(argv[i],"-lodmem") == 0 || strcmp(argv[i],"-lm") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->lod_mem = strtol(argv[i+1], NULL, 10);
+                ++i;
+            }
+            else if (strcmp(argv[i],"-searchmem") == 0 || strcmp(argv[i],"-sm") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->search_mem = strtol(argv[i+1], NULL, 10);
+                ++i;
+            }
+            else if (strcmp(argv[i],"-siderows") == 0 || strcmp(argv[i],"-sr") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->side_rows = strtol(argv[i+1], NULL, 10);
+                ++i;
+            }
+            else if (strcmp(argv[i],"-refine") == 0 || strcmp(argv[i],"-rf") == 0) {
+                if (((i+1)>=argc) || (argv[i+1][0] == '-')) {
+                    cmd_err_idx = i;
+                    ret = CMD_ERR_BAD_ARG;
+                    break;
+                }
+                OPTIONS->refine_ms = strtol(argv[i+1], NULL, 10);
+                ++i;
+            }
             else {
                 cmd_err_idx = i;
                 ret = CMD_ERR_BAD_OPTION;
@@ -469,9 +578,44 @@ void dump_cmd_opts(){
     fprintf(stderr,"        -rsquash              Remove all squashed instructions\n");
     fprintf(stderr,"        -ddummy               Disable dummy node insertion\n");
     fprintf(stderr,"        -dcutoff              Disable start/end cutoff\n");
+    fprintf(stderr,"        -warp                 Lock the second trace to the first with a\n");
+    fprintf(stderr,"                              cycle map built from matched instructions,\n");
+    fprintf(stderr,"                              instead of a single frequency ratio\n");
+    fprintf(stderr,"        -nosidecar            Always align the traces, instead of reusing\n");
+    fprintf(stderr,"                              the <trace1>.dptvalign file saved by an\n");
+    fprintf(stderr,"                              earlier run on the same traces\n");
+    fprintf(stderr,"        -atlas                Draw characters from a texture atlas in\n");
+    fprintf(stderr,"                              batches, instead of one blit each\n");
+    fprintf(stderr,"        -export <script>      Draw the viewports listed in script to image\n");
+    fprintf(stderr,"                              files without opening a window, then exit.\n");
+    fprintf(stderr,"                              Each line of script is <file> <first inst>\n");
+    fprintf(stderr,"                              <last inst> <first cycle> <last cycle> <zoom>\n");
+    fprintf(stderr,"                              [<offset>], written as PNG or .ppm, - for stdin\n");
+    fprintf(stderr,"        -framelog <file>      Write the time spent in each phase of every\n");
+    fprintf(stderr,"                              frame drawn to file, as CSV\n");
+    fprintf(stderr,"        -benchrender <passes> Run a fixed sequence of pans, zooms, searches\n");
+    fprintf(stderr,"                              and jumps passes times without a window,\n");
+    fprintf(stderr,"                              then print frame rates and frame times\n");
+    fprintf(stderr,"        -glyphbench           Time the character drawing paths against\n");
+    fprintf(stderr,"                              each other, then exit\n");
     fprintf(stderr,"        -fontfile <file>      Sets which font file to use, overwriting the\n");
     fprintf(stderr,"                              default font file\n");
     fprintf(stderr,"        -iwidth <width>       Sets the width of the instruction window\n");
+    fprintf(stderr,"        -threads <n>          Number of threads drawing the view (default\n");
+    fprintf(stderr,"                              one per core)\n");
+    fprintf(stderr,"        -tilemem <MB>         Memory for caching drawn tiles of the view,\n");
+    fprintf(stderr,"                              0 to disable (default 256)\n");
+    fprintf(stderr,"        -lodmem <MB>          Memory for the zoomed out overview of the\n");
+    fprintf(stderr,"                              traces, the finest levels are left out to\n");
+    fprintf(stderr,"                              fit (default 256)\n");
+    fprintf(stderr,"        -searchmem <MB>       Memory for the list of search hits, past it\n");
+    fprintf(stderr,"                              n and N step through the traces row by row\n");
+    fprintf(stderr,"                              (default 256)\n");
+    fprintf(stderr,"        -siderows <n>         Rows of drawn instruction text to keep, 0 to\n");
+    fprintf(stderr,"                              disable (default 1024)\n");
+    fprintf(stderr,"        -refine <ms>          While zooming or dragging, draw stages as blocks\n");
+    fprintf(stderr,"                              until input is still this long, 0 to always\n");
+    fprintf(stderr,"                              draw them fully (default 50)\n");
     fprintf(stderr,"\n<traceN>:\n");
     fprintf(stderr,"                              Name of each trace file, either one or two\n");
     fprintf(stderr,"                              traces, no default names.\n");
@@ -68,6 +68,20 @@ typedef struct options_type {
     int trace_remove_squash;
     int trace_disable_dummy;
     int trace_disable_cutoff;
+    int warp;
+    int no_sidecar;
+    int glyph_atlas;
+    int glyph_bench;
+    int headless;
+    char *export_script;
+    char *frame_log;
+    int bench_passes;
+    int threads;
+    int tile_mem;
+    int lod_mem;
+    int search_mem;
+    int side_rows;
+    int refine_ms;
     char *arg_command;
     int instr_window_width;
 } options_t;
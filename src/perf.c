@@ -0,0 +1,153 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "perf.h"
+
+static const char *perf_names[PERF_PHASES] = {
+    "clear", "trace0", "trace1", "view", "info", "box", "compose", "present", "total"
+};
+
+// Microseconds spent in each phase so far this frame
+static SDL_atomic_t perf_cur[PERF_PHASES];
+// Finished frames, in a ring
+static int perf_hist[PERF_HISTORY][PERF_PHASES];
+static int perf_n_hist = 0;
+static uint64_t perf_frame = 0;
+static bool perf_hud = false;
+static FILE *perf_log = NULL;
+// Set on a thread drawing ahead of the frame, whose time isn't the frame's
+static _Thread_local bool perf_skip = false;
+
+// Start timing frames, logging each one to a CSV file if log_path is given
+void init_perf(const char * log_path) {
+    for(int p = 0; p < PERF_PHASES; p++) {
+        SDL_AtomicSet(&perf_cur[p], 0);
+    }
+    if (log_path == NULL) {
+        return;
+    }
+    perf_log = fopen(log_path, "w");
+    if (perf_log == NULL) {
+        fprintf(stderr, "perf: failed to open %s\n", log_path);
+        return;
+    }
+    fprintf(perf_log, "frame");
+    for(int p = 0; p < PERF_PHASES; p++) {
+        fprintf(perf_log, ",%s_ms", perf_names[p]);
+    }
+    fprintf(perf_log, "\n");
+}
+
+void free_perf() {
+    if (perf_log != NULL) {
+        fclose(perf_log);
+        perf_log = NULL;
+    }
+}
+
+uint64_t perf_now() {
+    return SDL_GetPerformanceCounter();
+}
+
+// Count the time since start toward a phase of this frame, from any thread
+void perf_add(int phase, uint64_t start) {
+    if (perf_skip) {
+        return;
+    }
+    uint64_t ticks = SDL_GetPerformanceCounter() - start;
+    SDL_AtomicAdd(&perf_cur[phase], (int)(ticks * 1000000 / SDL_GetPerformanceFrequency()));
+}
+
+// Leave out the calling thread's time until called again with false
+void perf_skip_thread(bool skip) {
+    perf_skip = skip;
+}
+
+// File the times of the frame just drawn and start the next
+void perf_end_frame() {
+    int *frame = perf_hist[perf_frame % PERF_HISTORY];
+    for(int p = 0; p < PERF_PHASES; p++) {
+        frame[p] = SDL_AtomicSet(&perf_cur[p], 0);
+    }
+    if (perf_n_hist < PERF_HISTORY) {
+        perf_n_hist ++;
+    }
+    if (perf_log != NULL) {
+        fprintf(perf_log, "%"PRIu64, perf_frame);
+        for(int p = 0; p < PERF_PHASES; p++) {
+            fprintf(perf_log, ",%.3f", frame[p] / 1000.0);
+        }
+        fprintf(perf_log, "\n");
+    }
+    perf_frame ++;
+}
+
+void perf_toggle_hud() {
+    perf_hud = !perf_hud;
+}
+
+bool perf_hud_on() {
+    return perf_hud;
+}
+
+static int perf_cmp(const void * a, const void * b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+// One line of the average and 99th percentile of each phase over the last
+// frames, in milliseconds
+void perf_hud_text(char * buf, int len) {
+    int n = snprintf(buf, len, "ms avg/p99 of %d:", perf_n_hist);
+    int times[PERF_HISTORY];
+    for(int p = 0; p < PERF_PHASES && n < len; p++) {
+        double sum = 0;
+        for(int i = 0; i < perf_n_hist; i++) {
+            times[i] = perf_hist[i][p];
+            sum += times[i];
+        }
+        double avg = 0;
+        double p99 = 0;
+        if (perf_n_hist > 0) {
+            qsort(times, perf_n_hist, sizeof(int), perf_cmp);
+            avg = sum / perf_n_hist / 1000.0;
+            p99 = times[(perf_n_hist - 1) * 99 / 100] / 1000.0;
+        }
+        n += snprintf(buf + n, len - n, "  %s %.1f/%.1f", perf_names[p], avg, p99);
+    }
+}
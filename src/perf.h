@@ -0,0 +1,68 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Phases of a frame drawn by gfx_update. Clearing and the traces are drawn
+// per band, possibly on several threads at once, so their times are summed
+// over threads; the others are wall time on the main thread.
+#define PERF_CLEAR      0
+#define PERF_TRACE      1       // one per trace, PERF_TRACE + trace
+#define PERF_VIEW       3       // all of gfx_draw_view
+#define PERF_INFO       4
+#define PERF_BOX        5
+#define PERF_COMPOSE    6       // blits of every layer, including the box
+#define PERF_PRESENT    7
+#define PERF_TOTAL      8
+#define PERF_PHASES     9
+
+// Frames kept for the averages and percentiles
+#define PERF_HISTORY    240
+
+void init_perf(const char *log_path);
+void free_perf();
+uint64_t perf_now();
+void perf_add(int phase, uint64_t start);
+void perf_skip_thread(bool skip);
+void perf_end_frame();
+void perf_toggle_hud();
+bool perf_hud_on();
+void perf_hud_text(char *buf, int len);
+
+#endif
@@ -0,0 +1,232 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "pool.h"
+
+static SDL_Thread **workers = NULL;
+static int n_workers = 0;
+static SDL_mutex *pool_lock = NULL;
+static SDL_cond *pool_wake = NULL;
+static SDL_cond *pool_done = NULL;
+static bool pool_quit = false;
+
+// The job being run, changed only while no worker is inside it
+static pool_func_t job_func = NULL;
+static void *job_arg = NULL;
+static int job_n = 0;
+static SDL_atomic_t job_next;
+static int job_finished = 0;
+static int job_busy = 0;
+static uint64_t job_gen = 0;
+
+// Run by every thread that draws as it exits, and by free_pool for the
+// calling thread, so that thread-local caches are not leaked
+#define POOL_MAX_EXIT_FUNCS 8
+static pool_exit_func_t exit_funcs[POOL_MAX_EXIT_FUNCS];
+static int n_exit_funcs = 0;
+
+static int pool_worker(void *);
+static int run_job_items(pool_func_t, void *, int);
+
+// Start n_threads workers, or one per core besides the main thread if
+// negative
+void init_pool(int n_threads) {
+    if (n_threads < 0) {
+        n_threads = SDL_GetCPUCount() - 1;
+    }
+    pool_lock = SDL_CreateMutex();
+    pool_wake = SDL_CreateCond();
+    pool_done = SDL_CreateCond();
+    assert(pool_lock && pool_wake && pool_done);
+    workers = malloc(sizeof(SDL_Thread *) * (n_threads + 1));
+    assert(workers);
+    for(int i = 0; i < n_threads; i++) {
+        workers[n_workers] = SDL_CreateThread(pool_worker, "pool", NULL);
+        if (workers[n_workers] == NULL) {
+            fprintf(stderr, "pool: failed to start worker. %s\n", SDL_GetError());
+            break;
+        }
+        n_workers ++;
+    }
+}
+
+void free_pool() {
+    if (pool_lock == NULL) {
+        return;
+    }
+    SDL_LockMutex(pool_lock);
+    pool_quit = true;
+    SDL_CondBroadcast(pool_wake);
+    SDL_UnlockMutex(pool_lock);
+    for(int i = 0; i < n_workers; i++) {
+        SDL_WaitThread(workers[i], NULL);
+    }
+    free(workers);
+    workers = NULL;
+    n_workers = 0;
+    pool_thread_exit();
+    SDL_DestroyCond(pool_wake);
+    SDL_DestroyCond(pool_done);
+    SDL_DestroyMutex(pool_lock);
+    pool_lock = NULL;
+}
+
+// Register a function freeing a thread's own caches. Must be done before the
+// pool is started.
+void pool_at_thread_exit(pool_exit_func_t func) {
+    assert(n_exit_funcs < POOL_MAX_EXIT_FUNCS);
+    exit_funcs[n_exit_funcs++] = func;
+}
+
+void pool_thread_exit() {
+    for(int i = 0; i < n_exit_funcs; i++) {
+        exit_funcs[i]();
+    }
+}
+
+// Workers besides the calling thread
+int pool_threads() {
+    return n_workers;
+}
+
+// Call func(arg, i) for every i below n, spread over the workers and the
+// calling thread, and return once all have finished. Only one thread may
+// use the pool at a time, and func must not use it itself.
+void pool_for(pool_func_t func, void * arg, int n) {
+    if (n_workers == 0 || n <= 1) {
+        for(int i = 0; i < n; i++) {
+            func(arg, i);
+        }
+        return;
+    }
+    pool_start(func, arg, n);
+    int done = run_job_items(func, arg, n);
+    SDL_LockMutex(pool_lock);
+    job_finished += done;
+    SDL_UnlockMutex(pool_lock);
+    pool_finish(false);
+}
+
+// Hand a job to the workers and return straight away. Returns false if there
+// are no workers to run it. pool_finish must be called before the pool is
+// used again.
+bool pool_start(pool_func_t func, void * arg, int n) {
+    if (n_workers == 0) {
+        return false;
+    }
+    SDL_LockMutex(pool_lock);
+    // A worker that woke too late for the last job may still be leaving it
+    while(job_busy > 0) {
+        SDL_CondWait(pool_done, pool_lock);
+    }
+    job_func = func;
+    job_arg = arg;
+    job_n = n;
+    job_finished = 0;
+    SDL_AtomicSet(&job_next, 0);
+    job_gen ++;
+    SDL_CondBroadcast(pool_wake);
+    SDL_UnlockMutex(pool_lock);
+    return true;
+}
+
+// Wait for the job to end, or with cancel only for the items already started.
+// Returns how many items were run.
+int pool_finish(bool cancel) {
+    if (n_workers == 0) {
+        return 0;
+    }
+    SDL_LockMutex(pool_lock);
+    if (cancel) {
+        SDL_AtomicSet(&job_next, job_n);
+    }
+    // Wait for every worker to have left the job too, so none can pick up an
+    // index of the next one
+    while((!cancel && job_finished < job_n) || job_busy > 0) {
+        SDL_CondWait(pool_done, pool_lock);
+    }
+    int done = job_finished;
+    SDL_UnlockMutex(pool_lock);
+    return done;
+}
+
+static int pool_worker(void * data) {
+    uint64_t seen = 0;
+    SDL_LockMutex(pool_lock);
+    while(true) {
+        while(!pool_quit && job_gen == seen) {
+            SDL_CondWait(pool_wake, pool_lock);
+        }
+        if (pool_quit) {
+            break;
+        }
+        seen = job_gen;
+        pool_func_t func = job_func;
+        void *arg = job_arg;
+        int n = job_n;
+        job_busy ++;
+        SDL_UnlockMutex(pool_lock);
+
+        int done = run_job_items(func, arg, n);
+
+        SDL_LockMutex(pool_lock);
+        job_busy --;
+        job_finished += done;
+        if (job_busy == 0) {
+            SDL_CondSignal(pool_done);
+        }
+    }
+    SDL_UnlockMutex(pool_lock);
+    pool_thread_exit();
+    return 0;
+}
+
+// Take indices of the job until there are none left
+static int run_job_items(pool_func_t func, void * arg, int n) {
+    int done = 0;
+    while(true) {
+        int i = SDL_AtomicAdd(&job_next, 1);
+        if (i >= n) {
+            break;
+        }
+        func(arg, i);
+        done ++;
+    }
+    return done;
+}
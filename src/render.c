@@ -0,0 +1,208 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "dptv.h"
+#include "gfx.h"
+#include "event.h"
+#include "render.h"
+#include "pool.h"
+
+// Frames are drawn on their own thread so that input is read as it arrives,
+// however long a frame takes. The camera and search cursor are changed by the
+// event thread at once, holding view_lock only for as long as that takes, and
+// each frame is drawn from a copy of them taken as it starts. Everything else
+// drawing reads is changed only while holding render_lock as well, which the
+// render thread holds for the whole of a frame, so those changes wait for the
+// frame being drawn. Locks are always taken render_lock first.
+
+uint32_t frame_ready_event = (uint32_t)-1;
+
+static SDL_Thread *render_thread = NULL;
+static SDL_mutex *render_lock = NULL;
+static SDL_mutex *view_lock = NULL;
+static SDL_cond *view_cond = NULL;
+static bool render_stop = false;
+// A frame is being drawn, guarded by view_lock as presenting is
+static bool drawing = false;
+// A frame is drawn and waiting for the event thread to put it on screen
+static bool presenting = false;
+// Longest the render thread sleeps with nothing to do
+static const int render_wait_ms = 500;
+
+static int render_main(void * data);
+
+
+void start_render_thread() {
+    frame_ready_event = SDL_RegisterEvents(1);
+    render_lock = SDL_CreateMutex();
+    view_lock = SDL_CreateMutex();
+    view_cond = SDL_CreateCond();
+    assert(render_lock && view_lock && view_cond);
+    render_stop = false;
+    drawing = false;
+    presenting = false;
+    if (frame_ready_event != (uint32_t)-1) {
+        // Input goes to its own copy of the view from here on
+        gfx_use_input_view();
+        render_thread = SDL_CreateThread(render_main, "render", NULL);
+    }
+    if (render_thread == NULL) {
+        fprintf(stderr, "render: failed to start render thread, drawing from the event loop. %s\n", SDL_GetError());
+    }
+}
+
+void stop_render_thread() {
+    if (render_thread != NULL) {
+        SDL_LockMutex(view_lock);
+        render_stop = true;
+        SDL_CondSignal(view_cond);
+        SDL_UnlockMutex(view_lock);
+        SDL_WaitThread(render_thread, NULL);
+        render_thread = NULL;
+    }
+    SDL_DestroyCond(view_cond);
+    SDL_DestroyMutex(view_lock);
+    SDL_DestroyMutex(render_lock);
+    view_cond = NULL;
+    view_lock = NULL;
+    render_lock = NULL;
+}
+
+bool render_threaded() {
+    return render_thread != NULL;
+}
+
+// Take the drawing state for the event thread to change. A finished frame is
+// put on screen first. Otherwise this doesn't wait for a frame, returning
+// false if one is being drawn.
+bool render_acquire(bool frame_done) {
+    if (!frame_done && SDL_TryLockMutex(render_lock) != 0) {
+        // The render thread may only be starting or stopping the prefetch
+        SDL_LockMutex(view_lock);
+        bool busy = drawing;
+        SDL_UnlockMutex(view_lock);
+        if (busy) {
+            return false;
+        }
+        frame_done = true;
+    }
+    if (frame_done) {
+        SDL_LockMutex(render_lock);
+    }
+    SDL_LockMutex(view_lock);
+    if (presenting) {
+        gfx_present();
+        presenting = false;
+    }
+    // Tiles drawn while idle read what is about to change
+    gfx_prefetch_finish();
+    return true;
+}
+
+// Give it back, waking the render thread to draw whatever changed
+void render_release() {
+    SDL_CondSignal(view_cond);
+    SDL_UnlockMutex(view_lock);
+    SDL_UnlockMutex(render_lock);
+}
+
+// Change the camera or search cursor, even while a frame is being drawn
+void render_input_begin() {
+    if (render_thread != NULL) {
+        SDL_LockMutex(view_lock);
+    }
+}
+
+void render_input_end() {
+    if (render_thread != NULL) {
+        SDL_CondSignal(view_cond);
+        SDL_UnlockMutex(view_lock);
+    }
+}
+
+static int render_main(void * data) {
+    SDL_LockMutex(view_lock);
+    while(!render_stop) {
+        gfx_refine();
+        if (presenting || !gfx_is_dirty()) {
+            // Draw the tiles around the view until woken, but not past when
+            // a quickly drawn view is to be redrawn
+            int wait = gfx_refine_wait();
+            if (!presenting) {
+                SDL_UnlockMutex(view_lock);
+                SDL_LockMutex(render_lock);
+                gfx_prefetch_tiles();
+                SDL_UnlockMutex(render_lock);
+                SDL_LockMutex(view_lock);
+            }
+            if (!render_stop && (presenting || !gfx_is_dirty())) {
+                SDL_CondWaitTimeout(view_cond, view_lock, (wait >= 0 && wait < render_wait_ms) ? wait + 1 : render_wait_ms);
+            }
+            SDL_UnlockMutex(view_lock);
+            SDL_LockMutex(render_lock);
+            gfx_prefetch_finish();
+            SDL_UnlockMutex(render_lock);
+            SDL_LockMutex(view_lock);
+            continue;
+        }
+        // Input can still be applied while waiting for the frame's turn
+        SDL_UnlockMutex(view_lock);
+        frame_limit();
+        SDL_LockMutex(render_lock);
+        SDL_LockMutex(view_lock);
+        if (render_stop || presenting || !gfx_is_dirty()) {
+            SDL_UnlockMutex(render_lock);
+            continue;
+        }
+        gfx_take_view();
+        drawing = true;
+        SDL_UnlockMutex(view_lock);
+        gfx_update();
+        SDL_UnlockMutex(render_lock);
+        SDL_LockMutex(view_lock);
+        drawing = false;
+        presenting = true;
+        SDL_Event e;
+        memset(&e, 0, sizeof(e));
+        e.type = frame_ready_event;
+        SDL_PushEvent(&e);
+    }
+    SDL_UnlockMutex(view_lock);
+    pool_thread_exit();
+    return 0;
+}
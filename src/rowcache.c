@@ -0,0 +1,137 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "dptv.h"
+#include "rowcache.h"
+
+// Rows kept, more than fit on the screen at the smallest zoom that draws
+// stages, so the rows in view never evict each other
+#define ROW_CACHE_SLOTS 4096
+
+// Each drawing thread keeps its own rows
+static _Thread_local row_entry_t *row_cache = NULL;
+
+static void build_spans(row_entry_t *, instruction_t *);
+static void push_span(row_entry_t *, uint64_t, uint64_t, stage_t *);
+
+// Spans of an instruction's row, building them if the row isn't cached. gen
+// must change whenever the rows of the traces are rearranged.
+row_span_t * row_spans(instruction_t * inst, int trace, uint64_t pos, uint64_t gen, uint32_t * n) {
+    if (row_cache == NULL) {
+        row_cache = calloc(ROW_CACHE_SLOTS, sizeof(row_entry_t));
+        assert(row_cache);
+    }
+    row_entry_t *e = &row_cache[(pos * 2 + trace) % ROW_CACHE_SLOTS];
+    if (e->inst != inst || e->trace != trace || e->pos != pos || e->gen != gen) {
+        e->inst = inst;
+        e->trace = trace;
+        e->pos = pos;
+        e->gen = gen;
+        build_spans(e, inst);
+    }
+    *n = e->n;
+    return e->spans;
+}
+
+// Index of the first span that ends after cycle, n if there is none
+uint32_t row_span_find(row_span_t * spans, uint32_t n, uint64_t cycle) {
+    uint32_t lo = 0;
+    uint32_t hi = n;
+    while(lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (spans[mid].cycle + spans[mid].len <= cycle) lo = mid + 1;
+        else                                           hi = mid;
+    }
+    return lo;
+}
+
+void free_row_cache() {
+    if (row_cache == NULL) return;
+    for(int i = 0; i < ROW_CACHE_SLOTS; i++) {
+        free(row_cache[i].spans);
+    }
+    free(row_cache);
+    row_cache = NULL;
+}
+
+// The row runs from the first stage's cycle to the last cycle of any stage.
+// Each cycle shows the first stage listed at it, or '-' if none.
+static void build_spans(row_entry_t * e, instruction_t * inst) {
+    e->n = 0;
+    if (inst->n_stages == 0) {
+        return;
+    }
+    uint64_t start = inst->stages[0].cycle;
+    // Stages from the start on, in cycle order keeping the listed order for
+    // ties
+    stage_t **order = malloc(sizeof(stage_t *) * inst->n_stages);
+    assert(order);
+    uint32_t n_order = 0;
+    for(uint32_t s = 0; s < inst->n_stages; s++) {
+        stage_t *stage = &inst->stages[s];
+        if (stage->cycle < start) continue;
+        uint32_t j = n_order;
+        while(j > 0 && order[j-1]->cycle > stage->cycle) {
+            order[j] = order[j-1];
+            j--;
+        }
+        order[j] = stage;
+        n_order ++;
+    }
+    uint64_t cur = start;
+    for(uint32_t i = 0; i < n_order; i++) {
+        if (order[i]->cycle < cur) {
+            continue;
+        }
+        if (order[i]->cycle > cur) {
+            push_span(e, cur, order[i]->cycle - cur, NULL);
+        }
+        push_span(e, order[i]->cycle, 1, order[i]);
+        cur = order[i]->cycle + 1;
+    }
+    free(order);
+}
+
+static void push_span(row_entry_t * e, uint64_t cycle, uint64_t len, stage_t * stage) {
+    if (e->n >= e->size) {
+        e->size = (e->size == 0) ? 16 : e->size * 2;
+        e->spans = realloc(e->spans, sizeof(row_span_t) * e->size);
+        assert(e->spans);
+    }
+    e->spans[e->n] = (row_span_t){cycle, len, stage};
+    e->n ++;
+}
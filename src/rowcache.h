@@ -0,0 +1,64 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _ROWCACHE_H_
+#define _ROWCACHE_H_
+
+#include <stdint.h>
+#include "dptv.h"
+
+// Run of cycles in an instruction's row, either one stage or the '-' fill
+// between stages (stage is NULL)
+typedef struct row_span_type {
+    uint64_t cycle;
+    uint64_t len;
+    stage_t *stage;
+} row_span_t;
+
+// Cached spans of one row, found by its trace and position
+typedef struct row_entry_type {
+    instruction_t *inst;
+    int trace;
+    uint64_t pos;
+    uint64_t gen;
+    row_span_t *spans;
+    uint32_t n;
+    uint32_t size;
+} row_entry_t;
+
+row_span_t * row_spans(instruction_t *inst, int trace, uint64_t pos, uint64_t gen, uint32_t *n);
+uint32_t row_span_find(row_span_t *spans, uint32_t n, uint64_t cycle);
+void free_row_cache();
+
+#endif
@@ -35,15 +35,63 @@
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <limits.h>
 #include "gfx.h"
 #include "search.h"
 #include "options.h"
 #include "trace_handler.h"
+#include "pool.h"
 
 
 bool first_in;
 search_t* SEARCH;
 
+// Strings whose matches are kept, more than the sidebar and info panel show
+// at once
+#define SEARCH_CACHE_SLOTS 4096
+
+// Each drawing thread keeps its own matches
+static _Thread_local search_entry_t* search_cache = NULL;
+// Bumped whenever the pattern or where it is searched for changes
+static uint64_t search_gen = 1;
+
+// Rows of a trace matched by one job. Each job's bits start on a new word so
+// jobs never write to the same one.
+#define SEARCH_CHUNK_ROWS 4096
+
+static search_bits_t* match_bits = NULL;
+static int n_match_bits = 0;
+
+// The current hit as of the frame being drawn. Stepping between hits changes
+// SEARCH as the keys arrive, and frames only see it through this copy.
+static search_t search_drawn;
+
+// Every match of the committed pattern, built when it is entered. When there
+// are more than fit in OPTIONS->search_mem none are kept, and n and N scan
+// the rows from the current hit instead.
+static search_hit_t* search_hits = NULL;
+static uint64_t n_search_hits = 0;
+static bool search_indexed = false;
+static bool search_capped = false;
+// Hits the index jobs may still add, below 0 once they've found too many
+static SDL_atomic_t index_room;
+
+static bool search_in_sec(int sec, char* param_name);
+static bool field_match(const char* text, int sec, char* param_name);
+static bool stage_match(const stage_t* stage);
+static void build_trace_matches(search_bits_t* b);
+static uint64_t lay_out_chunk(search_bits_t* b, uint64_t c);
+static void push_match(search_entry_t* e, int pos, int len);
+static void index_field(search_hit_list_t* list, const char* text, uint64_t y, uint32_t stage, uint32_t param, int sec, char* param_name);
+static void index_row(search_hit_list_t* list, uint64_t r, int t);
+static bool search_scan(bool next, const search_hit_t* key, bool at, search_hit_t* found);
+static int hit_cmp(const search_hit_t* a, const search_hit_t* b);
+static uint64_t first_hit_at(uint64_t y);
+static search_hit_t cur_hit_key();
+static void build_index_from(bool had_hit, const search_hit_t* key);
+static void search_go_to(uint64_t i);
+static void go_to_hit(const search_hit_t* h);
+
 
 bool init_search() {
     // Initialize search
@@ -66,7 +114,7 @@ bool init_search() {
     
     SEARCH->cur_string = NULL;
     SEARCH->cur_string_pos = 0;
-    SEARCH->cur_string_num = 0;
+    SEARCH->hit_num = -1;
 
     SEARCH->is_colon = false;
 
@@ -74,102 +122,248 @@ bool init_search() {
 }
 
 
-int search_test(const char* text, char* pattern, int n) {
-    // Abort test if either is null
-    if (text == NULL || pattern == NULL || n < 0) {
-        return -1;
+// Whether matches in this section, or this parameter's value, count
+static bool search_in_sec(int sec, char* param_name) {
+    if (SEARCH->search_in[sec]) {
+        return true;
+    }
+    return param_name != NULL && sec == SEARCHSEC_PARAM_VALUE && search_has_param(param_name);
+}
+
+// Runs of text matching the pattern, overlapping matches merged, found once
+// per string and pattern. n is 0 if nothing matches or there is no search.
+const search_span_t* search_spans(const char* text, int sec, char* param_name, int* n) {
+    *n = 0;
+    if (text == NULL || SEARCH->pattern == NULL || SEARCH->pattern_len == 0) {
+        return NULL;
+    }
+    if (search_cache == NULL) {
+        search_cache = calloc(SEARCH_CACHE_SLOTS, sizeof(search_entry_t));
+        assert(search_cache);
     }
-    // Get string lengths
-    int tl = strlen(text);
-    int pl = strlen(pattern);
-    // Loop through and check all the substrings, finding the nth subsring equal to the pattern
-    int num_found = 0;
-    // Only need to check textlen-searchlen substrings, as ones beyond that would be too small to match the search
-    for(int i = 0; i <= (tl-pl); i++) {
-        // Check if this substring matches
-        if (strncmp(text+i, pattern, pl) == 0) {
-            // Found a match!
-            if (num_found == n) {
-                return i;
+    search_entry_t* e = &search_cache[((uintptr_t)text * 0x9E3779B97F4A7C15ULL >> 32) % SEARCH_CACHE_SLOTS];
+    if (e->text != text || e->sec != sec || e->gen != search_gen) {
+        e->text = text;
+        e->sec = sec;
+        e->gen = search_gen;
+        e->n = 0;
+        if (search_in_sec(sec, param_name)) {
+            int pl = SEARCH->pattern_len;
+            for(const char* p = strstr(text, SEARCH->pattern); p != NULL; p = strstr(p + 1, SEARCH->pattern)) {
+                push_match(e, p - text, pl);
             }
-            num_found ++;
         }
     }
-    // If we got here then it was not found
-    return -1;
+    *n = e->n;
+    return e->spans;
 }
 
-gfx_color_t* search_highlight(const char* text, gfx_color_t def_color, int sec, char* param_name) {
-    if (text == NULL) {
-        return NULL;
+static void push_match(search_entry_t* e, int pos, int len) {
+    if (e->n > 0 && e->spans[e->n - 1].start + e->spans[e->n - 1].len >= pos) {
+        e->spans[e->n - 1].len = pos + len - e->spans[e->n - 1].start;
+        return;
     }
-    // Returns an array of colors to be used to color this string input
-    int tl = strlen(text);
-    gfx_color_t* colors = malloc(sizeof(gfx_color_t) * tl);
-    for(int i = 0; i < tl; i++) {
-        colors[i] = def_color;
+    if (e->n >= e->size) {
+        e->size = (e->size == 0) ? 4 : e->size * 2;
+        e->spans = realloc(e->spans, sizeof(search_span_t) * e->size);
+        assert(e->spans);
     }
-    if (SEARCH->pattern == NULL) {
-        return colors;
+    e->spans[e->n] = (search_span_t){pos, len};
+    e->n ++;
+}
+
+// Start of the current match if it is in text, otherwise -1
+int search_cur_pos(const char* text) {
+    if (SEARCH->pattern == NULL || text == NULL || search_drawn.cur_string != text) {
+        return -1;
+    }
+    return search_drawn.cur_string_pos;
+}
+
+void free_search_cache() {
+    if (search_cache == NULL) return;
+    for(int i = 0; i < SEARCH_CACHE_SLOTS; i++) {
+        free(search_cache[i].spans);
     }
-    // Check if searching in this section
-    if (SEARCH->search_in[sec] == false) {
-        // Check if searching in specific parameter
-        if (param_name == NULL || sec != SEARCHSEC_PARAM_VALUE) {
-            return colors;
+    free(search_cache);
+    search_cache = NULL;
+}
+
+static bool field_match(const char* text, int sec, char* param_name) {
+    return text != NULL && strstr(text, SEARCH->pattern) != NULL && search_in_sec(sec, param_name);
+}
+
+static bool stage_match(const stage_t* stage) {
+    // Whether any field of the stage matches the pattern
+    bool match = field_match(stage->id_str, SEARCHSEC_ID, NULL) || field_match(stage->name, SEARCHSEC_NAME, NULL);
+    for(uint32_t p = 0; p < stage->n_params && !match; p++) {
+        parameter_t* param = &stage->params[p];
+        match = field_match(param->name, SEARCHSEC_PARAM_NAME, param->name) || field_match(param->value, SEARCHSEC_PARAM_VALUE, param->name);
+    }
+    return match;
+}
+
+void search_build_matches() {
+    // Find every stage with a field matching the pattern, so drawing a stage
+    // is a bit test
+    search_free_matches();
+    if (SEARCH->pattern == NULL) return;
+    n_match_bits = OPTIONS->num_traces;
+    match_bits = calloc(n_match_bits, sizeof(search_bits_t));
+    assert(match_bits);
+    for(int t = 0; t < n_match_bits; t++) {
+        match_bits[t].trace = t;
+        build_trace_matches(&match_bits[t]);
+    }
+}
+
+static void build_trace_matches(search_bits_t* b) {
+    b->n_rows = TRACES[b->trace]->n_insts;
+    b->n_chunks = (b->n_rows + SEARCH_CHUNK_ROWS - 1) / SEARCH_CHUNK_ROWS;
+    b->chunk = malloc(sizeof(uint64_t) * (b->n_chunks + 1));
+    b->first = malloc(sizeof(uint32_t) * (b->n_rows + 1));
+    assert(b->chunk && b->first);
+    uint64_t bit = 0;
+    for(uint64_t c = 0; c < b->n_chunks; c++) {
+        b->chunk[c] = bit;
+        bit += lay_out_chunk(b, c);
+    }
+    b->chunk[b->n_chunks] = bit;
+    b->words = calloc(bit / 64 + 1, sizeof(uint64_t));
+    assert(b->words);
+    pool_for(search_match_job, b, b->n_chunks);
+}
+
+static uint64_t lay_out_chunk(search_bits_t* b, uint64_t c) {
+    // Number the stages of a chunk's rows, returning the bits it takes in
+    // whole words
+    trace_t* trace = TRACES[b->trace];
+    uint64_t r0 = c * SEARCH_CHUNK_ROWS;
+    uint64_t r1 = (r0 + SEARCH_CHUNK_ROWS < b->n_rows) ? r0 + SEARCH_CHUNK_ROWS : b->n_rows;
+    uint32_t bit = 0;
+    for(uint64_t r = r0; r < r1; r++) {
+        b->first[r] = bit;
+        bit += trace->insts[r].n_stages;
+    }
+    return ((uint64_t)bit + 63) & ~(uint64_t)63;
+}
+
+void search_splice_matches(uint64_t r0, uint64_t r1, uint64_t n_rows) {
+    // Rows [r0, r1) were replaced by n_rows rows. Only the chunks holding
+    // them are matched again, the words of the chunks below are moved.
+    for(int t = 0; t < n_match_bits; t++) {
+        search_bits_t* b = &match_bits[t];
+        uint64_t n_insts = TRACES[t]->n_insts;
+        uint64_t t_r1 = (r1 < b->n_rows) ? r1 : b->n_rows;
+        uint64_t t_r0 = (r0 < t_r1) ? r0 : t_r1;
+        bool at_end = t_r1 == b->n_rows;
+        if (n_insts != b->n_rows && !at_end) {
+            // The rows below moved into other chunks
+            free(b->chunk);
+            free(b->first);
+            free(b->words);
+            build_trace_matches(b);
+            continue;
         }
-        if (!search_has_param(param_name)) {
-            return colors;
+        uint64_t n_chunks = (n_insts + SEARCH_CHUNK_ROWS - 1) / SEARCH_CHUNK_ROWS;
+        uint64_t c0 = t_r0 / SEARCH_CHUNK_ROWS;
+        uint64_t c1 = at_end ? n_chunks : (t_r1 + SEARCH_CHUNK_ROWS - 1) / SEARCH_CHUNK_ROWS;
+        uint64_t old_end = b->chunk[at_end ? b->n_chunks : c1];
+        uint64_t old_total = b->chunk[b->n_chunks];
+        if (n_insts != b->n_rows) {
+            b->chunk = realloc(b->chunk, sizeof(uint64_t) * (n_chunks + 1));
+            b->first = realloc(b->first, sizeof(uint32_t) * (n_insts + 1));
+            assert(b->chunk && b->first);
+            b->n_rows = n_insts;
+            b->n_chunks = n_chunks;
         }
-    }
-    // Setup highlighted text
-    for(int i = 0; true; i++) {
-        int pos = search_test(text, SEARCH->pattern, i);
-        if (pos == -1) {
-            break;
+        uint64_t bit = b->chunk[c0];
+        for(uint64_t c = c0; c < c1; c++) {
+            b->chunk[c] = bit;
+            bit += lay_out_chunk(b, c);
+        }
+        int64_t shift = (int64_t)bit - (int64_t)old_end;
+        uint64_t n_words = (old_total + shift) / 64 + 1;
+        if (shift > 0) {
+            b->words = realloc(b->words, sizeof(uint64_t) * n_words);
+            assert(b->words);
         }
-        for(int j = 0; j < SEARCH->pattern_len; j++) {
-            assert(pos+j < tl);
-            colors[pos+j] = COLORS->highlight;
+        memmove(&b->words[bit / 64], &b->words[old_end / 64], sizeof(uint64_t) * ((old_total - old_end) / 64 + 1));
+        if (shift < 0) {
+            b->words = realloc(b->words, sizeof(uint64_t) * n_words);
+            assert(b->words);
+        }
+        memset(&b->words[b->chunk[c0] / 64], 0, sizeof(uint64_t) * ((bit - b->chunk[c0]) / 64));
+        if (at_end) {
+            b->chunk[n_chunks] = bit;
+        } else {
+            for(uint64_t c = c1; c <= n_chunks; c++) {
+                b->chunk[c] += shift;
+            }
+        }
+        for(uint64_t c = c0; c < c1; c++) {
+            search_match_job(b, c);
         }
     }
-    // Setup current highlighted text for current search position
-    if (SEARCH->cur_string == text) {
-        int pos = SEARCH->cur_string_pos;
-        for(int j = 0; j < SEARCH->pattern_len; j++) {
-            assert(pos+j < tl);
-            colors[pos+j] = COLORS->cur_search;
+}
+
+void search_match_job(void* arg, int index) {
+    search_bits_t* b = (search_bits_t*)arg;
+    trace_t* trace = TRACES[b->trace];
+    uint64_t r0 = (uint64_t)index * SEARCH_CHUNK_ROWS;
+    uint64_t r1 = (r0 + SEARCH_CHUNK_ROWS < b->n_rows) ? r0 + SEARCH_CHUNK_ROWS : b->n_rows;
+    for(uint64_t r = r0; r < r1; r++) {
+        instruction_t* inst = &trace->insts[r];
+        for(uint32_t s = 0; s < inst->n_stages; s++) {
+            if (stage_match(&inst->stages[s])) {
+                uint64_t bit = b->chunk[index] + b->first[r] + s;
+                b->words[bit / 64] |= (uint64_t)1 << (bit % 64);
+            }
         }
     }
-    return colors;
 }
 
-gfx_color_t search_highlight_overall(const char* text, gfx_color_t color, int sec, char* param_name) {
-    // Get most significant color from provided text
-    if (text == NULL || SEARCH->pattern == NULL) {
-        return color;
+void search_free_matches() {
+    for(int t = 0; t < n_match_bits; t++) {
+        free(match_bits[t].chunk);
+        free(match_bits[t].first);
+        free(match_bits[t].words);
     }
-    if (color.int_color == COLORS->cur_search.int_color) {
-        return color;
+    free(match_bits);
+    match_bits = NULL;
+    n_match_bits = 0;
+}
+
+bool search_stage_match(int trace, uint64_t row, uint32_t s) {
+    if (SEARCH->pattern == NULL) {
+        return false;
     }
-    int pos = search_test(text, SEARCH->pattern, 0);
-    if (pos == -1) {
-        return color;
+    if (match_bits == NULL) {
+        // Still being typed, the bitmap is built once the search is entered
+        trace_t* t = TRACES[trace];
+        return row < t->n_insts && s < t->insts[row].n_stages && stage_match(&t->insts[row].stages[s]);
     }
-    if (SEARCH->search_in[sec] == false) {
-        // Check if searching in specific parameter
-        if (param_name == NULL || sec != SEARCHSEC_PARAM_VALUE) {
-            return color;
-        }
-        if (!search_has_param(param_name)) {
-            return color;
-        }
+    if (trace >= n_match_bits || row >= match_bits[trace].n_rows) {
+        return false;
     }
-    color = COLORS->highlight;
-    if (SEARCH->cur_string == text) {
-        color = COLORS->cur_search;
+    uint64_t bit = match_bits[trace].chunk[row / SEARCH_CHUNK_ROWS] + match_bits[trace].first[row] + s;
+    return (match_bits[trace].words[bit / 64] >> (bit % 64)) & 1;
+}
+
+bool search_is_cur_stage(const stage_t* stage) {
+    // Whether the current match is in one of this stage's fields
+    return SEARCH->pattern != NULL && search_drawn.cur_string != NULL && stage == search_drawn.cur_stage &&
+        search_drawn.cur_section >= SEARCHSEC_ID && search_drawn.cur_section < SEARCHSEC_BEGIN;
+}
+
+void search_take_cursor() {
+    // Show the current hit as it is now in the frame about to be drawn,
+    // redrawing the rows it moved between
+    if (search_drawn.cur_string != SEARCH->cur_string || search_drawn.cur_string_pos != SEARCH->cur_string_pos || search_drawn.cur_y != SEARCH->cur_y) {
+        gfx_invalidate_row(search_drawn.cur_y);
+        gfx_invalidate_row(SEARCH->cur_y);
     }
-    return color;
+    search_drawn = *SEARCH;
 }
 
 
@@ -184,6 +378,7 @@ void search_input_begin(bool type) {
     }
     SEARCH->input[0] = '\0';
     setup_cmd();
+    gfx_invalidate_view();
     first_in = true;
 }
 
@@ -229,6 +424,8 @@ void search_setup_pattern() {
     if (SEARCH->is_colon) {
         return;
     }
+    // Highlighting follows the pattern as it is typed
+    gfx_invalidate_view();
     free(SEARCH->pattern);
     search_param_clear();
     memset(SEARCH->search_in, false, SEARCHSEC_NUM);
@@ -271,6 +468,9 @@ void search_setup_pattern() {
     }
     free(input);
     SEARCH->pattern_len = strlen(SEARCH->pattern);
+    search_gen ++;
+    search_free_index();
+    search_free_matches();
 }
 
 void search_param_add(char* param) {
@@ -311,18 +511,16 @@ void search_input_finish() {
         // Jump to instruction number
         gfx_jump_y(strtol(SEARCH->input, NULL, 10) * OPTIONS->num_traces);
     } else {
-        // Setup searching variables to point to start of area to search
+        // Start before the first hit
         SEARCH->cur_y = 0;
-        SEARCH->cur_string_num = -1;
-        SEARCH->trace_ind = 0;
-        SEARCH->instr_ind = 0;
-        SEARCH->stage_ind = 0;
-        SEARCH->param_ind = 0;
+        SEARCH->hit_num = -1;
+        SEARCH->cur_section = SEARCHSEC_BEGIN;
         SEARCH->cur_instr = NULL;
         SEARCH->cur_stage = NULL;
         SEARCH->cur_param = NULL;
-        SEARCH->cur_section = SEARCHSEC_BEGIN;
         SEARCH->cur_string = NULL;
+        search_build_matches();
+        search_build_index();
         // Search for first
         search_find(true, NULL);
     }
@@ -334,11 +532,16 @@ void search_end() {
         free(SEARCH->pattern);
         SEARCH->pattern = NULL;
         SEARCH->pattern_len = 0;
+        search_gen ++;
+        search_free_matches();
+        search_free_index();
+        SEARCH->hit_num = -1;
     }
     free(SEARCH->input);
     SEARCH->input = NULL;
     SEARCH->input_len = 0;
     SEARCH->is_colon = false;
+    gfx_invalidate_view();
 }
 
 
@@ -346,99 +549,42 @@ int64_t search_find(bool next, int64_t* x) {
     if (SEARCH->pattern == NULL) {
         return -1;
     }
-    uint64_t y_start = SEARCH->cur_y;
-    bool left_y = false;
-    bool returned_y = false;
-    while(true) {
-        // Search for pattern in current string
-        if (next) {
-            SEARCH->cur_string_num ++;
-        } else {
-            if (SEARCH->cur_string_num < 0) {
-                // Get last valid string position
-                SEARCH->cur_string_num = 0;
-                while(true) {
-                    if (search_test(SEARCH->cur_string, SEARCH->pattern, SEARCH->cur_string_num) == -1) {
-                        break;
-                    }
-                    SEARCH->cur_string_num ++;
-                }
+    // First hit after the current one, or the last before it, wrapping
+    // around the ends of the trace
+    search_hit_t key = cur_hit_key();
+    if (search_capped) {
+        search_hit_t h;
+        if (!search_scan(next, &key, false, &h)) {
+            SEARCH->cur_string = NULL;
+            setup_cmd();
+            return -1;
+        }
+        SEARCH->hit_num = 0;
+        go_to_hit(&h);
+    } else {
+        if (n_search_hits == 0) {
+            SEARCH->cur_string = NULL;
+            setup_cmd();
+            return -1;
+        }
+        uint64_t lo = 0;
+        uint64_t hi = n_search_hits;
+        while(lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            int c = hit_cmp(&search_hits[mid], &key);
+            if (c < 0 || (next && c == 0)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
             }
-            SEARCH->cur_string_num --;
         }
-        int pos = search_test(SEARCH->cur_string, SEARCH->pattern, SEARCH->cur_string_num);
-        if (pos != -1) {
-            SEARCH->cur_string_pos = pos;
-            break;
+        uint64_t i;
+        if (next) {
+            i = (lo < n_search_hits) ? lo : 0;
         } else {
-            while(true) {
-                // Move to next section to search in
-                SEARCH->cur_string_num = -1;
-                if (next) {
-                    search_next();
-                } else {
-                    search_prev();
-                }
-                // Detect infinite loop when we've left starting y-position, returned to that y-position, then left it again
-                // TODO: This probobally doesn't work when viewing a trace with just one instruction (only one possible y-position). Is this a problem worth fixing?
-                if (!left_y) {
-                    if (SEARCH->cur_y != y_start) left_y = true;
-                } else {
-                    if (!returned_y) {
-                        if (SEARCH->cur_y == y_start) returned_y = true;
-                    } else {
-                        if (SEARCH->cur_y != y_start) {
-                            // Infinite loop, nothing must match the pattern
-                            return -1;
-                        }
-                    }
-                }
-                // Check if our current section is one we're selected to search in
-                if (SEARCH->search_in[SEARCH->cur_section] == true) {
-                    break;
-                }
-                // Check if looking at specific parameter value selected to search for
-                if (SEARCH->search_in_params != NULL) {
-                    if (SEARCH->cur_section == SEARCHSEC_PARAM_VALUE) {
-                        if (search_has_param(SEARCH->cur_param->name)) {
-                            break;
-                        }
-                    }
-                }
-            }
-            // Get next string to check
-            switch(SEARCH->cur_section) {
-                case(SEARCHSEC_PC):
-                    // Get Program Counter text
-                    SEARCH->cur_string = SEARCH->cur_instr->pc_text;
-                    break;
-                case(SEARCHSEC_INSTR):
-                    // Get Instruction name
-                    SEARCH->cur_string = SEARCH->cur_instr->instruction;
-                    break;
-                case(SEARCHSEC_CYCLE):
-                    // May or may not impliment searching for cycle numbers in the future (probobally not :>)
-                    break;
-                case(SEARCHSEC_ID):
-                    // Get stage identifier
-                    SEARCH->cur_string = SEARCH->cur_stage->id_str;
-                    break;
-                case(SEARCHSEC_NAME):
-                    // Get stage name
-                    SEARCH->cur_string = SEARCH->cur_stage->name;
-                    break;
-                case(SEARCHSEC_PARAM_NAME):
-                    // Get parameter name
-                    SEARCH->cur_string = SEARCH->cur_param->name;
-                    break;
-                case(SEARCHSEC_PARAM_VALUE):
-                    // Get parameter value
-                    SEARCH->cur_string = SEARCH->cur_param->value;
-                    break;
-                default:
-                    break;
-            }
+            i = (lo > 0) ? lo - 1 : n_search_hits - 1;
         }
+        search_go_to(i);
     }
     // Get x position
     if (x != NULL) {
@@ -450,163 +596,345 @@ int64_t search_find(bool next, int64_t* x) {
             *x = SEARCH->cur_stage->cycle;
         }
     }
+    setup_cmd();
     return (int64_t)SEARCH->cur_y;
 }
 
+void search_build_index() {
+    // Find every match of the committed pattern once, so stepping between
+    // them is a binary search rather than a walk over the traces
+    search_hit_t key = cur_hit_key();
+    build_index_from(SEARCH->hit_num >= 0, &key);
+}
 
-
-void search_next() {
-    // Go to next string to search
-    switch(SEARCH->cur_section) {
-        case(SEARCHSEC_PC):
-            // To instruction text
-            SEARCH->cur_section = SEARCHSEC_INSTR;
-            break;
-        case(SEARCHSEC_INSTR):
-            // To stage id
-            SEARCH->cur_section = SEARCHSEC_ID;
-            SEARCH->stage_ind = 0;
-        search_next_stage:
-            // Continue to next instruction if no more stages
-            if (SEARCH->stage_ind >= SEARCH->cur_instr->n_stages) {
-                // To PC
-                SEARCH->cur_section = SEARCHSEC_PC;
-                SEARCH->cur_y ++;
-                // Switch Trace
-                SEARCH->trace_ind ++;
-                if (SEARCH->trace_ind >= OPTIONS->num_traces) {
-                    SEARCH->trace_ind = 0;
-                    SEARCH->instr_ind ++;
-                }
-                // Check if loop back to top instruction
-                if (SEARCH->instr_ind >= TRACES[SEARCH->trace_ind]->n_insts) {
-                    SEARCH->cur_y = 0;
-                    SEARCH->instr_ind = 0;
-                }
-                SEARCH->cur_instr = &TRACES[SEARCH->trace_ind]->insts[SEARCH->instr_ind];
+static void build_index_from(bool had_hit, const search_hit_t* key) {
+    // Rows are split between jobs whose hits are joined in order. If there
+    // was a current hit, the search moves to the first hit at or after key.
+    search_free_index();
+    if (SEARCH->pattern == NULL) return;
+    search_indexed = true;
+    SEARCH->hit_num = -1;
+    if (SEARCH->pattern_len == 0) return;
+    uint64_t n_rows = 0;
+    for(int t = 0; t < OPTIONS->num_traces; t++) {
+        if (TRACES[t]->n_insts > n_rows) n_rows = TRACES[t]->n_insts;
+    }
+    int n_jobs = (n_rows + SEARCH_CHUNK_ROWS - 1) / SEARCH_CHUNK_ROWS;
+    search_hit_list_t* lists = calloc(n_jobs + 1, sizeof(search_hit_list_t));
+    assert(lists);
+    uint64_t max_search_hits = ((uint64_t)OPTIONS->search_mem << 20) / sizeof(search_hit_t);
+    SDL_AtomicSet(&index_room, (max_search_hits < INT_MAX) ? max_search_hits : INT_MAX);
+    pool_for(search_index_job, lists, n_jobs);
+    if (SDL_AtomicGet(&index_room) < 0) {
+        // Too many to keep, step through them by scanning the rows
+        for(int j = 0; j < n_jobs; j++) {
+            free(lists[j].hits);
+        }
+        free(lists);
+        search_capped = true;
+        search_hit_t h;
+        if (had_hit && search_scan(true, key, true, &h)) {
+            SEARCH->hit_num = 0;
+            go_to_hit(&h);
+        }
+        setup_cmd();
+        return;
+    }
+    // Join the lists onto the end of the first, freeing each once copied
+    for(int j = 0; j < n_jobs; j++) {
+        n_search_hits += lists[j].n;
+    }
+    search_hits = realloc(lists[0].hits, sizeof(search_hit_t) * (n_search_hits + 1));
+    assert(search_hits);
+    uint64_t n = lists[0].n;
+    for(int j = 1; j < n_jobs; j++) {
+        memcpy(&search_hits[n], lists[j].hits, sizeof(search_hit_t) * lists[j].n);
+        n += lists[j].n;
+        free(lists[j].hits);
+    }
+    free(lists);
+    // Rows may have moved, stay on the first hit at or after the old spot
+    if (had_hit && n_search_hits > 0) {
+        uint64_t lo = 0;
+        uint64_t hi = n_search_hits;
+        while(lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (hit_cmp(&search_hits[mid], key) < 0) {
+                lo = mid + 1;
             } else {
-                SEARCH->cur_stage = &SEARCH->cur_instr->stages[SEARCH->stage_ind];
+                hi = mid;
             }
-            break;
-        case(SEARCHSEC_ID):
-            // To stage name
-            SEARCH->cur_section = SEARCHSEC_NAME;
-            break;
-        case(SEARCHSEC_NAME):
-            // To param name
-            SEARCH->cur_section = SEARCHSEC_PARAM_NAME;
-            SEARCH->param_ind = 0;
-        search_next_param:
-            // Continue to next stage if no more parameters
-            if (SEARCH->param_ind >= SEARCH->cur_stage->n_params) {
-                SEARCH->cur_section = SEARCHSEC_ID;
-                SEARCH->stage_ind ++;
-                goto search_next_stage;
+        }
+        search_go_to((lo < n_search_hits) ? lo : n_search_hits - 1);
+    }
+    setup_cmd();
+}
+
+void search_splice_index(uint64_t r0, uint64_t r1, uint64_t n_rows) {
+    // Rows [r0, r1) were replaced by n_rows rows. Only those are indexed
+    // again, the hits below are moved.
+    if (!search_indexed || SEARCH->pattern_len == 0) return;
+    int nt = OPTIONS->num_traces;
+    int64_t dy = ((int64_t)n_rows - (int64_t)(r1 - r0)) * nt;
+    // The current hit moves with its row, or stays put in the window
+    bool had_hit = SEARCH->hit_num >= 0;
+    search_hit_t key = cur_hit_key();
+    if (key.y >= r1 * nt) {
+        key.y += dy;
+    } else if (key.y >= r0 * nt) {
+        key = (search_hit_t){r0 * nt, 0, 0, -1, -1};
+    }
+    SEARCH->hit_num = -1;
+    if (search_capped) {
+        search_hit_t h;
+        if (had_hit && search_scan(true, &key, true, &h)) {
+            SEARCH->hit_num = 0;
+            go_to_hit(&h);
+        }
+        setup_cmd();
+        return;
+    }
+    search_hit_list_t list = {NULL, 0, 0};
+    for(uint64_t r = r0; r < r0 + n_rows; r++) {
+        for(int t = 0; t < nt; t++) {
+            index_row(&list, r, t);
+        }
+    }
+    // Hits [lo, hi) are in the old rows of the window
+    uint64_t lo = first_hit_at(r0 * nt);
+    uint64_t hi = first_hit_at(r1 * nt);
+    uint64_t tail = n_search_hits - hi;
+    uint64_t n = lo + list.n + tail;
+    uint64_t max_search_hits = ((uint64_t)OPTIONS->search_mem << 20) / sizeof(search_hit_t);
+    if (n > max_search_hits) {
+        // Too many now, build it again to step through them by scanning
+        free(list.hits);
+        build_index_from(had_hit, &key);
+        return;
+    }
+    if (list.n > hi - lo) {
+        search_hits = realloc(search_hits, sizeof(search_hit_t) * (n + 1));
+        assert(search_hits);
+    }
+    memmove(&search_hits[lo + list.n], &search_hits[hi], sizeof(search_hit_t) * tail);
+    memcpy(&search_hits[lo], list.hits, sizeof(search_hit_t) * list.n);
+    for(uint64_t i = lo + list.n; i < n; i++) {
+        search_hits[i].y += dy;
+    }
+    n_search_hits = n;
+    free(list.hits);
+    if (had_hit && n_search_hits > 0) {
+        uint64_t i = 0;
+        uint64_t j = n_search_hits;
+        while(i < j) {
+            uint64_t mid = i + (j - i) / 2;
+            if (hit_cmp(&search_hits[mid], &key) < 0) {
+                i = mid + 1;
             } else {
-                SEARCH->cur_param = &SEARCH->cur_stage->params[SEARCH->param_ind];
+                j = mid;
             }
-            break;
-        case(SEARCHSEC_PARAM_NAME):
-            // To param value
-            SEARCH->cur_section = SEARCHSEC_PARAM_VALUE;
-            break;
-        case(SEARCHSEC_PARAM_VALUE):
-            // To next param name
-            SEARCH->cur_section = SEARCHSEC_PARAM_NAME;
-            SEARCH->param_ind ++;
-            goto search_next_param;
-        case(SEARCHSEC_BEGIN):
-            // Begin searching
-            SEARCH->cur_section = SEARCHSEC_PC;
-            SEARCH->instr_ind = 0;
-            SEARCH->trace_ind = 0;
-            SEARCH->cur_instr = &TRACES[0]->insts[0];
-        default:
-            break;
+        }
+        search_go_to((i < n_search_hits) ? i : n_search_hits - 1);
     }
+    setup_cmd();
 }
 
+static uint64_t first_hit_at(uint64_t y) {
+    // Index of the first hit on row y or below
+    uint64_t lo = 0;
+    uint64_t hi = n_search_hits;
+    while(lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (search_hits[mid].y < y) lo = mid + 1;
+        else                        hi = mid;
+    }
+    return lo;
+}
 
-void search_prev() {
-    // Go to previous string to search
-    switch(SEARCH->cur_section) {
-        case(SEARCHSEC_PC):
-            // To param value
-            SEARCH->cur_section = SEARCHSEC_PARAM_VALUE;
-            // Move to previous instruction
-            SEARCH->cur_y --;
-            // Switch between traces
-            SEARCH->trace_ind --;
-            if (SEARCH->trace_ind < 0) {
-                SEARCH->trace_ind = OPTIONS->num_traces-1;
-                // Check if loop back to bottom instruction
-                if (SEARCH->instr_ind == 0) {
-                    SEARCH->instr_ind = TRACES[SEARCH->trace_ind]->n_insts - 1;
-                    SEARCH->cur_y = TRACES[SEARCH->trace_ind]->n_insts * OPTIONS->num_traces - OPTIONS->num_traces;
-                } else {
-                    SEARCH->instr_ind --;
-                }
-            }
-            SEARCH->cur_instr = &TRACES[SEARCH->trace_ind]->insts[SEARCH->instr_ind];
-            // Check if no stages
-            if (SEARCH->cur_instr->n_stages == 0) {
-                // To instruction text
-                SEARCH->cur_section = SEARCHSEC_INSTR;
-                break;
-            }
-            // Go to last stage
-            SEARCH->stage_ind = SEARCH->cur_instr->n_stages - 1;
-            SEARCH->cur_stage = &SEARCH->cur_instr->stages[SEARCH->stage_ind];
-        search_to_last_param:
-            // Check if no parameters
-            if (SEARCH->cur_stage->n_params == 0) {
-                // To stage name
-                SEARCH->cur_section = SEARCHSEC_NAME;
+void search_index_job(void* arg, int index) {
+    search_hit_list_t* list = &((search_hit_list_t*)arg)[index];
+    int nt = OPTIONS->num_traces;
+    uint64_t r0 = (uint64_t)index * SEARCH_CHUNK_ROWS;
+    for(uint64_t r = r0; r < r0 + SEARCH_CHUNK_ROWS; r++) {
+        // Stop once the jobs together have found more than fit
+        if (SDL_AtomicGet(&index_room) < 0) {
+            free(list->hits);
+            *list = (search_hit_list_t){NULL, 0, 0};
+            return;
+        }
+        uint64_t n = list->n;
+        for(int t = 0; t < nt; t++) {
+            index_row(list, r, t);
+        }
+        if (list->n > n) {
+            SDL_AtomicAdd(&index_room, -(int)(list->n - n));
+        }
+    }
+    // Give back the slack, every list is held until they are joined
+    if (list->n > 0 && list->n < list->size) {
+        list->hits = realloc(list->hits, sizeof(search_hit_t) * list->n);
+        list->size = list->n;
+    }
+}
+
+static void index_row(search_hit_list_t* list, uint64_t r, int t) {
+    // Add the hits in one trace's row, in the order n steps through them
+    if (r >= TRACES[t]->n_insts) return;
+    instruction_t* inst = &TRACES[t]->insts[r];
+    uint64_t y = r * OPTIONS->num_traces + t;
+    index_field(list, inst->pc_text, y, 0, 0, SEARCHSEC_PC, NULL);
+    index_field(list, inst->instruction, y, 0, 0, SEARCHSEC_INSTR, NULL);
+    for(uint32_t s = 0; s < inst->n_stages; s++) {
+        stage_t* stage = &inst->stages[s];
+        index_field(list, stage->id_str, y, s, 0, SEARCHSEC_ID, NULL);
+        index_field(list, stage->name, y, s, 0, SEARCHSEC_NAME, NULL);
+        for(uint32_t p = 0; p < stage->n_params; p++) {
+            parameter_t* param = &stage->params[p];
+            index_field(list, param->name, y, s, p, SEARCHSEC_PARAM_NAME, param->name);
+            index_field(list, param->value, y, s, p, SEARCHSEC_PARAM_VALUE, param->name);
+        }
+    }
+}
+
+static bool search_scan(bool next, const search_hit_t* key, bool at, search_hit_t* found) {
+    // Walk the rows from the key's, wrapping around the ends of the traces,
+    // to the first hit after it (or at it) or the last before it
+    int nt = OPTIONS->num_traces;
+    uint64_t n_y = 0;
+    for(int t = 0; t < nt; t++) {
+        if (TRACES[t]->n_insts * nt > n_y) n_y = TRACES[t]->n_insts * nt;
+    }
+    if (n_y == 0) return false;
+    uint64_t y0 = (key->y < n_y) ? key->y : n_y - 1;
+    search_hit_list_t list = {NULL, 0, 0};
+    bool hit = false;
+    // The key's row is looked at again last, for the hits on its other side
+    for(uint64_t k = 0; k <= n_y && !hit; k++) {
+        uint64_t y = next ? (y0 + k) % n_y : (y0 + n_y - k % n_y) % n_y;
+        list.n = 0;
+        index_row(&list, y / nt, y % nt);
+        for(uint64_t i = 0; i < list.n; i++) {
+            search_hit_t* h = &list.hits[next ? i : list.n - 1 - i];
+            int c = (k > 0) ? (next ? 1 : -1) : hit_cmp(h, key);
+            if (next ? (c > 0 || (at && c == 0)) : c < 0) {
+                *found = *h;
+                hit = true;
                 break;
             }
-            // Go to last parameter
-            SEARCH->param_ind = SEARCH->cur_stage->n_params - 1;
-            SEARCH->cur_param = &SEARCH->cur_stage->params[SEARCH->param_ind];
+        }
+    }
+    free(list.hits);
+    return hit;
+}
+
+static void index_field(search_hit_list_t* list, const char* text, uint64_t y, uint32_t stage, uint32_t param, int sec, char* param_name) {
+    if (text == NULL || !search_in_sec(sec, param_name)) {
+        return;
+    }
+    // Overlapping matches are separate hits
+    for(const char* p = strstr(text, SEARCH->pattern); p != NULL; p = strstr(p + 1, SEARCH->pattern)) {
+        if (list->n >= list->size) {
+            list->size = (list->size == 0) ? 64 : list->size * 2;
+            list->hits = realloc(list->hits, sizeof(search_hit_t) * list->size);
+            assert(list->hits);
+        }
+        list->hits[list->n++] = (search_hit_t){y, stage, param, sec, p - text};
+    }
+}
+
+void search_free_index() {
+    free(search_hits);
+    search_hits = NULL;
+    n_search_hits = 0;
+    search_indexed = false;
+    search_capped = false;
+}
+
+// Order of two hits, as n steps through them
+static int hit_cmp(const search_hit_t* a, const search_hit_t* b) {
+    if (a->y != b->y) return (a->y < b->y) ? -1 : 1;
+    // The instruction's own fields come before its stages, and a stage's id
+    // and name before its parameters
+    bool a_stage = a->sec >= SEARCHSEC_ID;
+    bool b_stage = b->sec >= SEARCHSEC_ID;
+    if (a_stage != b_stage) return a_stage ? 1 : -1;
+    if (a_stage && a->stage != b->stage) return (a->stage < b->stage) ? -1 : 1;
+    bool a_param = a->sec >= SEARCHSEC_PARAM_NAME;
+    bool b_param = b->sec >= SEARCHSEC_PARAM_NAME;
+    if (a_param != b_param) return a_param ? 1 : -1;
+    if (a_param && a->param != b->param) return (a->param < b->param) ? -1 : 1;
+    if (a->sec != b->sec) return (a->sec < b->sec) ? -1 : 1;
+    if (a->pos != b->pos) return (a->pos < b->pos) ? -1 : 1;
+    return 0;
+}
+
+// Where the search is now, before every hit if it hasn't started
+static search_hit_t cur_hit_key() {
+    if (SEARCH->hit_num < 0) {
+        return (search_hit_t){0, 0, 0, -1, -1};
+    }
+    return (search_hit_t){SEARCH->cur_y, SEARCH->stage_ind, SEARCH->param_ind, SEARCH->cur_section, SEARCH->cur_string_pos};
+}
+
+static void search_go_to(uint64_t i) {
+    // Make hit i of the index the current match
+    SEARCH->hit_num = i;
+    go_to_hit(&search_hits[i]);
+}
+
+static void go_to_hit(const search_hit_t* h) {
+    int nt = OPTIONS->num_traces;
+    SEARCH->cur_y = h->y;
+    SEARCH->trace_ind = h->y % nt;
+    SEARCH->instr_ind = h->y / nt;
+    SEARCH->stage_ind = h->stage;
+    SEARCH->param_ind = h->param;
+    SEARCH->cur_section = h->sec;
+    SEARCH->cur_instr = &TRACES[SEARCH->trace_ind]->insts[SEARCH->instr_ind];
+    SEARCH->cur_stage = NULL;
+    SEARCH->cur_param = NULL;
+    if (h->sec >= SEARCHSEC_ID) {
+        SEARCH->cur_stage = &SEARCH->cur_instr->stages[h->stage];
+    }
+    if (h->sec >= SEARCHSEC_PARAM_NAME) {
+        SEARCH->cur_param = &SEARCH->cur_stage->params[h->param];
+    }
+    switch(h->sec) {
+        case(SEARCHSEC_PC):
+            SEARCH->cur_string = SEARCH->cur_instr->pc_text;
             break;
         case(SEARCHSEC_INSTR):
-            // To program counter
-            SEARCH->cur_section = SEARCHSEC_PC;
+            SEARCH->cur_string = SEARCH->cur_instr->instruction;
             break;
         case(SEARCHSEC_ID):
-            // Continue to instruction text if no more stages
-            if (SEARCH->stage_ind == 0) {
-                // To instruction text
-                SEARCH->cur_section = SEARCHSEC_INSTR;
-            } else {
-                // To parameter value
-                SEARCH->cur_section = SEARCHSEC_PARAM_VALUE;
-                SEARCH->stage_ind --;
-                SEARCH->cur_stage = &SEARCH->cur_instr->stages[SEARCH->stage_ind];
-                // Go to last parameter of previous stage
-                goto search_to_last_param;
-            }
+            SEARCH->cur_string = SEARCH->cur_stage->id_str;
             break;
         case(SEARCHSEC_NAME):
-            // To stage id
-            SEARCH->cur_section = SEARCHSEC_ID;
+            SEARCH->cur_string = SEARCH->cur_stage->name;
             break;
         case(SEARCHSEC_PARAM_NAME):
-            // Continue to stage name if no more parameters
-            if (SEARCH->param_ind == 0) {
-                SEARCH->cur_section = SEARCHSEC_NAME;
-            } else {
-                // To param value
-                SEARCH->cur_section = SEARCHSEC_PARAM_VALUE;
-                SEARCH->param_ind --;
-                SEARCH->cur_param = &SEARCH->cur_stage->params[SEARCH->param_ind];
-            }
+            SEARCH->cur_string = SEARCH->cur_param->name;
             break;
         case(SEARCHSEC_PARAM_VALUE):
-            // To next param name
-            SEARCH->cur_section = SEARCHSEC_PARAM_NAME;
+            SEARCH->cur_string = SEARCH->cur_param->value;
             break;
         default:
             break;
     }
+    SEARCH->cur_string_pos = h->pos;
 }
 
+bool search_status(char* text, int n) {
+    // Which hit is current for the command bar, false if nothing to show
+    if (SEARCH->pattern == NULL || !search_indexed || input_mode == INMODE_SEARCH) {
+        return false;
+    }
+    if (search_capped) {
+        snprintf(text, n, "Hits for \"%s\" not counted, too many for -searchmem", SEARCH->pattern);
+    } else if (n_search_hits == 0) {
+        snprintf(text, n, "No hits for \"%s\"", SEARCH->pattern);
+    } else {
+        snprintf(text, n, "Hit %" PRId64 " of %" PRIu64, search_drawn.hit_num + 1, n_search_hits);
+    }
+    return true;
+}
@@ -40,10 +40,69 @@
 #include "gfx.h"
 
 
+// Run of characters of a string matching the search pattern
+typedef struct search_span_type {
+    int start;
+    int len;
+} search_span_t;
+
+// Cached matches of one string under the current pattern
+typedef struct search_entry_type {
+    const char* text;
+    int sec;
+    uint64_t gen;
+    search_span_t* spans;
+    int n;
+    int size;
+} search_entry_t;
+
+
+// Stages of one trace with a field matching the pattern, one bit each. Each
+// chunk of rows starts on a word of its own.
+typedef struct search_bits_type {
+    int trace;
+    uint64_t n_rows;
+    uint64_t n_chunks;
+    uint64_t* chunk;        // bit each chunk starts at
+    uint32_t* first;        // bit of each row's first stage, within its chunk
+    uint64_t* words;
+} search_bits_t;
+
+// One match of the committed pattern. Hits are sorted in the order n steps
+// through them: by row, then the instruction's own fields, then each stage's
+// id and name followed by its parameters.
+typedef struct search_hit_type {
+    uint64_t y;             // row * num_traces + trace
+    uint32_t stage;
+    uint32_t param;
+    int sec;
+    int pos;                // start of the match in the field
+} search_hit_t;
+
+// Hits found by one index job
+typedef struct search_hit_list_type {
+    search_hit_t* hits;
+    uint64_t n;
+    uint64_t size;
+} search_hit_list_t;
+
+
 bool init_search();
-int search_test(const char* text, char* pattern, int n);
-gfx_color_t* search_highlight(const char* text, gfx_color_t def, int sec, char* param_name);
-gfx_color_t search_highlight_overall(const char* text, gfx_color_t color, int sec, char* param_name);
+const search_span_t* search_spans(const char* text, int sec, char* param_name, int* n);
+int search_cur_pos(const char* text);
+void free_search_cache();
+void search_build_matches();
+void search_splice_matches(uint64_t r0, uint64_t r1, uint64_t n_rows);
+void search_free_matches();
+void search_match_job(void* arg, int index);
+bool search_stage_match(int trace, uint64_t row, uint32_t s);
+void search_take_cursor();
+bool search_is_cur_stage(const stage_t* stage);
+void search_build_index();
+void search_splice_index(uint64_t r0, uint64_t r1, uint64_t n_rows);
+void search_free_index();
+void search_index_job(void* arg, int index);
+bool search_status(char* text, int n);
 
 void search_input_begin(bool type);
 void search_input_end();
@@ -58,8 +117,6 @@ bool search_has_param(char* param_name);
 
 void search_end();
 int64_t search_find(bool, int64_t* x);
-void search_next();
-void search_prev();
 
 
 
@@ -101,7 +158,8 @@ typedef struct search_type {
     
     char* cur_string;
     int cur_string_pos;
-    int cur_string_num;
+    // Index of the current hit, -1 before the first
+    int64_t hit_num;
 } search_t;
 
 
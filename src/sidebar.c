@@ -0,0 +1,164 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "sidebar.h"
+
+// Rows are kept in sets of this many, found by display row, so consecutive
+// rows never compete for a place
+#define SIDE_WAYS 4
+
+static side_row_t *side_rows = NULL;
+static int n_sets = 0;
+// Band threads look up and take rows at the same time
+static SDL_mutex *side_lock = NULL;
+// Bumped when everything drawn so far is out of date
+static uint64_t side_gen = 0;
+// Bumped once per frame, rows used in the current frame aren't evicted
+static uint64_t side_clock = 1;
+
+// Keep about n rows, none if 0
+void init_side_rows(int n) {
+    n_sets = n / SIDE_WAYS;
+    if (n_sets == 0) {
+        return;
+    }
+    side_rows = calloc(n_sets * SIDE_WAYS, sizeof(side_row_t));
+    assert(side_rows);
+    side_lock = SDL_CreateMutex();
+    assert(side_lock);
+}
+
+void free_side_rows() {
+    for(int i = 0; i < n_sets * SIDE_WAYS; i++) {
+        SDL_FreeSurface(side_rows[i].surf);
+    }
+    free(side_rows);
+    SDL_DestroyMutex(side_lock);
+    side_rows = NULL;
+    side_lock = NULL;
+    n_sets = 0;
+}
+
+bool side_rows_enabled() {
+    return n_sets > 0;
+}
+
+void side_new_frame() {
+    side_clock ++;
+}
+
+// Drawn row at this zoom, sidebar width and color, or NULL
+side_row_t * side_find(uint64_t row, double scale, int width, uint64_t color) {
+    side_row_t *set = &side_rows[(row % n_sets) * SIDE_WAYS];
+    side_row_t *found = NULL;
+    SDL_LockMutex(side_lock);
+    for(int i = 0; i < SIDE_WAYS; i++) {
+        side_row_t *r = &set[i];
+        if (r->used && r->ready && r->row == row && r->scale == scale && r->width == width && r->color == color && r->gen == side_gen) {
+            r->last_used = side_clock;
+            found = r;
+            break;
+        }
+    }
+    SDL_UnlockMutex(side_lock);
+    return found;
+}
+
+// Take the least recently used row of its set for a new row h pixels tall,
+// to be drawn by the caller and then marked ready. Returns NULL if the whole
+// set is in use this frame.
+side_row_t * side_alloc(uint64_t row, double scale, int width, uint64_t color, int h) {
+    side_row_t *set = &side_rows[(row % n_sets) * SIDE_WAYS];
+    side_row_t *lru = NULL;
+    SDL_LockMutex(side_lock);
+    for(int i = 0; i < SIDE_WAYS; i++) {
+        side_row_t *r = &set[i];
+        if (!r->used || r->gen != side_gen) {
+            lru = r;
+            break;
+        }
+        if (r->last_used != side_clock && (lru == NULL || r->last_used < lru->last_used)) {
+            lru = r;
+        }
+    }
+    if (lru != NULL) {
+        lru->used = true;
+        lru->ready = false;
+        lru->row = row;
+        lru->scale = scale;
+        lru->width = width;
+        lru->color = color;
+        lru->gen = side_gen;
+        lru->last_used = side_clock;
+    }
+    SDL_UnlockMutex(side_lock);
+    if (lru == NULL) {
+        return NULL;
+    }
+    // Surfaces are reused while the size stays the same
+    if (lru->surf != NULL && (lru->surf->w != width || lru->surf->h != h)) {
+        SDL_FreeSurface(lru->surf);
+        lru->surf = NULL;
+    }
+    if (lru->surf == NULL) {
+        lru->surf = SDL_CreateRGBSurface(0, width, h, 32, 0, 0, 0, 0);
+        assert(lru->surf);
+    }
+    return lru;
+}
+
+void side_ready(side_row_t * r) {
+    SDL_LockMutex(side_lock);
+    r->ready = true;
+    SDL_UnlockMutex(side_lock);
+}
+
+void side_invalidate_all() {
+    side_gen ++;
+}
+
+// Throw away a display row, at any zoom
+void side_invalidate_row(uint64_t row) {
+    if (n_sets == 0) return;
+    side_row_t *set = &side_rows[(row % n_sets) * SIDE_WAYS];
+    for(int i = 0; i < SIDE_WAYS; i++) {
+        if (set[i].row == row) {
+            set[i].used = false;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _SIDEBAR_H_
+#define _SIDEBAR_H_
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// One row of the instruction sidebar as drawn at a zoom level, the program
+// counter and instruction text of one display row
+typedef struct side_row_type {
+    bool used;
+    bool ready;
+    uint64_t row;
+    double scale;
+    int width;
+    uint64_t color;
+    uint64_t gen;
+    uint64_t last_used;
+    SDL_Surface *surf;
+} side_row_t;
+
+void init_side_rows(int n);
+void free_side_rows();
+bool side_rows_enabled();
+void side_new_frame();
+side_row_t * side_find(uint64_t row, double scale, int width, uint64_t color);
+side_row_t * side_alloc(uint64_t row, double scale, int width, uint64_t color, int h);
+void side_ready(side_row_t *r);
+void side_invalidate_all();
+void side_invalidate_row(uint64_t row);
+
+#endif
@@ -0,0 +1,99 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "textcache.h"
+
+// Strings kept, far more than the command bar, info panel and help menu
+// show at once
+#define TEXT_CACHE_SLOTS 1024
+
+static text_entry_t *text_cache = NULL;
+
+static uint32_t pack_color(SDL_Color color) {
+    return ((uint32_t)color.r << 24) | ((uint32_t)color.g << 16) | ((uint32_t)color.b << 8) | color.a;
+}
+
+static text_entry_t * text_slot(const char *text, uint32_t color, double x_scale, double y_scale) {
+    if (text_cache == NULL) {
+        text_cache = calloc(TEXT_CACHE_SLOTS, sizeof(text_entry_t));
+        assert(text_cache);
+    }
+    // FNV-1a over the string, then the color and scales
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for(const char *c = text; *c != '\0'; c++) {
+        h = (h ^ (uint8_t)*c) * 0x100000001B3ULL;
+    }
+    h = (h ^ color) * 0x100000001B3ULL;
+    h = (h ^ (uint64_t)(x_scale * 1024)) * 0x100000001B3ULL;
+    h = (h ^ (uint64_t)(y_scale * 1024)) * 0x100000001B3ULL;
+    return &text_cache[h % TEXT_CACHE_SLOTS];
+}
+
+// Rendered surface of this string, or NULL
+SDL_Surface * text_cache_find(const char *text, SDL_Color color, double x_scale, double y_scale) {
+    uint32_t c = pack_color(color);
+    text_entry_t *e = text_slot(text, c, x_scale, y_scale);
+    if (e->text != NULL && e->color == c && e->x_scale == x_scale && e->y_scale == y_scale && strcmp(e->text, text) == 0) {
+        return e->surf;
+    }
+    return NULL;
+}
+
+// Keep a rendered string, the cache takes the surface and frees it when the
+// slot is reused
+void text_cache_put(const char *text, SDL_Color color, double x_scale, double y_scale, SDL_Surface *surf) {
+    uint32_t c = pack_color(color);
+    text_entry_t *e = text_slot(text, c, x_scale, y_scale);
+    free(e->text);
+    SDL_FreeSurface(e->surf);
+    e->text = strdup(text);
+    e->color = c;
+    e->x_scale = x_scale;
+    e->y_scale = y_scale;
+    e->surf = surf;
+}
+
+void free_text_cache() {
+    if (text_cache == NULL) return;
+    for(int i = 0; i < TEXT_CACHE_SLOTS; i++) {
+        free(text_cache[i].text);
+        SDL_FreeSurface(text_cache[i].surf);
+    }
+    free(text_cache);
+    text_cache = NULL;
+}
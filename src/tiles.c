@@ -0,0 +1,134 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "tiles.h"
+
+static tile_t *tiles = NULL;
+static int n_tiles = 0;
+// Bumped when everything drawn so far is out of date
+static uint64_t tile_gen = 0;
+// Bumped once per frame, tiles used in the current frame aren't evicted
+static uint64_t tile_clock = 1;
+
+// Keep as many tiles as fit in budget bytes, none if 0
+void init_tiles(uint64_t budget) {
+    n_tiles = budget / (TILE_W * TILE_H * 4);
+    if (n_tiles == 0) {
+        return;
+    }
+    tiles = calloc(n_tiles, sizeof(tile_t));
+    assert(tiles);
+}
+
+bool tiles_enabled() {
+    return n_tiles > 0;
+}
+
+void tile_new_frame() {
+    tile_clock ++;
+}
+
+// Drawn tile at this position and zoom, or NULL
+tile_t * tile_find(int64_t row, int64_t col, double scale, int off) {
+    for(int i = 0; i < n_tiles; i++) {
+        tile_t *t = &tiles[i];
+        if (t->used && t->ready && t->row == row && t->col == col && t->scale == scale && t->off == off && t->gen == tile_gen) {
+            t->last_used = tile_clock;
+            return t;
+        }
+    }
+    return NULL;
+}
+
+// Take the least recently used tile for a new position, to be drawn by the
+// caller. Returns NULL if every tile is in use this frame.
+tile_t * tile_alloc(int64_t row, int64_t col, double scale, int off, double row_h) {
+    tile_t *lru = NULL;
+    for(int i = 0; i < n_tiles; i++) {
+        tile_t *t = &tiles[i];
+        if (!t->used || t->gen != tile_gen) {
+            lru = t;
+            break;
+        }
+        if (t->last_used != tile_clock && (lru == NULL || t->last_used < lru->last_used)) {
+            lru = t;
+        }
+    }
+    if (lru == NULL) {
+        return NULL;
+    }
+    if (lru->surf == NULL) {
+        lru->surf = SDL_CreateRGBSurface(0, TILE_W, TILE_H, 32, 0, 0, 0, 0);
+        assert(lru->surf);
+    }
+    lru->used = true;
+    lru->ready = false;
+    lru->row = row;
+    lru->col = col;
+    lru->scale = scale;
+    lru->off = off;
+    lru->gen = tile_gen;
+    lru->row_h = row_h;
+    lru->last_used = tile_clock;
+    return lru;
+}
+
+// Give back a tile that was allocated but never drawn
+void tile_discard(tile_t * tile) {
+    tile->used = false;
+    tile->ready = false;
+}
+
+void tile_invalidate_all() {
+    tile_gen ++;
+}
+
+// Throw away the tiles showing a display row, at any zoom
+void tile_invalidate_row(uint64_t row) {
+    for(int i = 0; i < n_tiles; i++) {
+        tile_t *t = &tiles[i];
+        if (!t->used) continue;
+        // One pixel either side for characters that spill over
+        int64_t y0 = floor(row * t->row_h) - 1;
+        int64_t y1 = floor((row + 1) * t->row_h) + 1;
+        if (y1 >= t->row * TILE_H && y0 < (t->row + 1) * TILE_H) {
+            t->used = false;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _TILES_H_
+#define _TILES_H_
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Size of a tile of the stage area, in pixels
+#define TILE_W 256
+#define TILE_H 256
+
+// One tile of the stage area as drawn at a zoom level. Tile (row, col)
+// covers world pixels from (col * TILE_W, row * TILE_H).
+typedef struct tile_type {
+    bool used;
+    bool ready;
+    int64_t row;
+    int64_t col;
+    double scale;
+    int off;
+    uint64_t gen;
+    double row_h;
+    uint64_t last_used;
+    SDL_Surface *surf;
+} tile_t;
+
+void init_tiles(uint64_t budget);
+bool tiles_enabled();
+void tile_new_frame();
+tile_t * tile_find(int64_t row, int64_t col, double scale, int off);
+tile_t * tile_alloc(int64_t row, int64_t col, double scale, int off, double row_h);
+void tile_discard(tile_t *tile);
+void tile_invalidate_all();
+void tile_invalidate_row(uint64_t row);
+
+#endif
@@ -43,6 +43,9 @@
 #include "trace_handler.h"
 #include "trace_gem.h"
 #include "yaml.h"
+#include "warp.h"
+#include "align_cache.h"
+#include "diverge.h"
 
 // array of traces
 trace_t **TRACES = NULL;
@@ -57,12 +60,27 @@ static char * get_file_ext(char *);
 long trace_find_common(int*, int*, int*, int*);
 long trace_find_common_sub(int*, int*, int*, int*, trace_t*, trace_t*);
 int find_commited(trace_t*, int*);
-int find_commited_prev(trace_t*, int*);
-static void add_dummy_nodes(trace_t*, int, int);
 static void fill_dummy(instruction_t *);
-static void remove_start(trace_t*, int);
-static void remove_end(trace_t*, int);
-static void shift_add_dummy(trace_t*, int, int, int, int);
+static void free_inst_data(instruction_t *);
+
+// Group of instructions used for alignment, a committed instruction followed
+// by the squashed instructions fetched after it
+typedef struct align_group_type {
+    uint64_t start;
+    uint32_t len;
+    char *key;
+} align_group_t;
+
+static uint64_t collect_window(trace_t*, uint64_t, uint64_t, instruction_t**, uint64_t**);
+static align_map_t * compute_alignment();
+static void apply_alignment(align_map_t*);
+static void rows_from_map(instruction_t*, int64_t*, uint64_t, instruction_t*);
+static uint64_t build_groups(instruction_t*, uint64_t, uint64_t, align_group_t**);
+static int64_t find_group(align_group_t*, uint64_t, uint64_t*, uint64_t);
+static bool group_match(align_group_t*, align_group_t*);
+static void align_groups(align_group_t*, uint64_t, align_group_t*, uint64_t, int64_t*, int64_t*, uint64_t*);
+static void emit_group(align_group_t*, align_group_t*, int64_t*, int64_t*, uint64_t*);
+static void splice_window(trace_t*, uint64_t, uint64_t, instruction_t*, uint64_t);
 
 // initialize array of traces
 void init_traces(){
@@ -82,6 +100,11 @@ void init_traces(){
 
     if (OPTIONS->num_traces > 1) {
         align_multi_trace();
+        if (OPTIONS->warp) {
+            build_warp();
+        }
+        build_diverge_index();
+        dump_diverge_summary();
     }
 
 
@@ -188,6 +211,33 @@ static void align_multi_trace(){
     printf("aligning traces...");
     fflush(stdout);
 
+    // Reuse the saved alignment of this pair of traces if there is one
+    uint64_t hashes[2] = {trace_content_hash(TRACES[0]), trace_content_hash(TRACES[1])};
+    align_map_t *align = NULL;
+    if (!OPTIONS->no_sidecar) {
+        align = load_align_sidecar(hashes);
+        if (align != NULL) {
+            apply_alignment(align);
+            free_align_map(align);
+            printf("done (cached).\n");
+            fflush(stdout);
+            return;
+        }
+    }
+
+    align = compute_alignment();
+    apply_alignment(align);
+    if (!OPTIONS->no_sidecar) {
+        save_align_sidecar(align, hashes);
+    }
+    free_align_map(align);
+
+    printf("done.\n");
+    fflush(stdout);
+
+}
+
+static align_map_t * compute_alignment() {
     // Find position in traces where dynamic instruction streams match up
     int start_a, start_b, end_a, end_b;
     long length = trace_find_common(&start_a, &start_b, &end_a, &end_b);
@@ -195,91 +245,309 @@ static void align_multi_trace(){
         fprintf(stderr, "Error: Could not find common stream of instructions, traces do not match\n");
         exit(1);
     }
-    
-    // Either remove nodes before & after matching section, or add padding to begining / end depending on options
+
+    // Without the cutoff the whole of each trace is aligned
     if (OPTIONS->trace_disable_cutoff) {
-        // Add dummy nodes
-        int add_start_a = (start_b > start_a) ? start_b - start_a : 0;
-        int add_start_b = (start_a > start_b) ? start_a - start_b : 0;
-        add_dummy_nodes(TRACES[0], 0, add_start_a);
-        add_dummy_nodes(TRACES[1], 0, add_start_b);
-        end_a += add_start_a;
-        end_b += add_start_b;
-        int add_end_a = (end_b > end_a) ? end_b - end_a : 0;
-        int add_end_b = (end_a > end_b) ? end_a - end_b : 0;
-        add_dummy_nodes(TRACES[0], end_a, add_end_a);
-        add_dummy_nodes(TRACES[1], end_b, add_end_b);
-    } else {
-        // Cutoff start/end
-        remove_end(TRACES[0], end_a);
-        remove_end(TRACES[1], end_b);
-        remove_start(TRACES[0], start_a);
-        remove_start(TRACES[1], start_b);
+        start_a = 0;
+        start_b = 0;
+        end_a = TRACES[0]->n_insts;
+        end_b = TRACES[1]->n_insts;
     }
-    
+
+    align_map_t *align = malloc(sizeof(align_map_t));
+    assert(align);
+    align->start[0] = start_a;
+    align->start[1] = start_b;
+    align->end[0] = end_a;
+    align->end[1] = end_b;
+    align->disable_dummy = OPTIONS->trace_disable_dummy;
+    align->disable_cutoff = OPTIONS->trace_disable_cutoff;
+    uint64_t size = TRACES[0]->n_insts + TRACES[1]->n_insts + 1;
+    uint64_t n[2] = {0, 0};
+    for(int t = 0; t < 2; t++) {
+        align->n_src[t] = TRACES[t]->n_insts;
+        align->map[t] = malloc(sizeof(int64_t) * size);
+        assert(align->map[t]);
+    }
+
     if (OPTIONS->trace_disable_dummy) {
-        printf("done.\n");
-        fflush(stdout);
-        return;
+        for(int t = 0; t < 2; t++) {
+            for(int64_t i = align->start[t]; i < align->end[t]; i++) align->map[t][n[t]++] = i;
+        }
+    } else {
+        // Add dummy nodes between commited instructions. Both sections commit
+        // the same instructions, so the k-th groups of each are paired up.
+        align_group_t *groups[2];
+        uint64_t n_groups[2];
+        for(int t = 0; t < 2; t++) {
+            n_groups[t] = build_groups(TRACES[t]->insts + align->start[t], align->start[t],
+                                       align->end[t] - align->start[t], &groups[t]);
+        }
+        uint64_t most = (n_groups[0] > n_groups[1]) ? n_groups[0] : n_groups[1];
+        for(uint64_t k = 0; k < most; k++) {
+            emit_group((k < n_groups[0]) ? &groups[0][k] : NULL, (k < n_groups[1]) ? &groups[1][k] : NULL,
+                       align->map[0], align->map[1], &n[0]);
+        }
+        n[1] = n[0];
+        free(groups[0]);
+        free(groups[1]);
     }
 
-    
-    // Add dummy nodes between commited instructions
-    int i0 = 0;
-    int i1 = 0;
-    trace_t * trace0 = TRACES[0];
-    trace_t * trace1 = TRACES[1];
-    // Find how long the new instruction array needs to be
-    long l = 0;
-    while(true) {
-        int m0 = find_commited(trace0, &i0) + 1;
-        int m1 = find_commited(trace1, &i1) + 1;
-        if (m0 > m1)    { l += (long)m0; }
-        else            { l += (long)m1; }
-        i0 ++;  i1 ++;
-        if (i0 >= trace0->n_insts || i1 >= trace1->n_insts) break;
-    }
-    // Resize instruction arrays
-    trace0->insts = realloc(trace0->insts, l*sizeof(instruction_t));
-    trace1->insts = realloc(trace1->insts, l*sizeof(instruction_t));
-    // Shift instructions and add dummy instructions
-    i0 --;  i1 --;
-    int shift_to = l - 1;
-    while(true) {
-        int m0 = find_commited_prev(trace0, &i0) + 1;
-        int m1 = find_commited_prev(trace1, &i1) + 1;
-        if (i0 < 0 || i1 < 0) break;
-        int m = (m0 < m1) ? m1 : m0;
-        // Shift & Add dummys
-        shift_add_dummy(trace0, shift_to, i0+m0-1, m-m0, m0);
-        shift_add_dummy(trace1, shift_to, i1+m1-1, m-m1, m1);
-        shift_to -= m;
-        i0 --;
-        i1 --;
-    }
-    trace0->n_insts = l;
-    trace1->n_insts = l;
+    align->n_rows[0] = n[0];
+    align->n_rows[1] = n[1];
+    return align;
+}
 
-    
+static void apply_alignment(align_map_t * align) {
+    // Rebuild each instruction array in row order
+    for(int t = 0; t < 2; t++) {
+        trace_t *trace = TRACES[t];
+        instruction_t *rows = malloc(sizeof(instruction_t) * (align->n_rows[t] + 1));
+        assert(rows);
+        rows_from_map(trace->insts, align->map[t], align->n_rows[t], rows);
+        // Free the instructions that were cut off, any not given a row
+        bool *kept = calloc(align->n_src[t] + 1, sizeof(bool));
+        assert(kept);
+        for(uint64_t r = 0; r < align->n_rows[t]; r++) {
+            if (align->map[t][r] >= 0) kept[align->map[t][r]] = true;
+        }
+        for(uint64_t i = 0; i < align->n_src[t]; i++) {
+            if (!kept[i]) free_inst_data(&trace->insts[i]);
+        }
+        free(kept);
+        free(trace->insts);
+        trace->insts = rows;
+        trace->n_insts = align->n_rows[t];
+    }
+}
 
-    printf("done.\n");
-    fflush(stdout);
+static void rows_from_map(instruction_t * src, int64_t * map, uint64_t n, instruction_t * rows) {
+    for(uint64_t r = 0; r < n; r++) {
+        if (map[r] < 0) fill_dummy(&rows[r]);
+        else            rows[r] = src[map[r]];
+    }
+}
+
+uint64_t realign_local(uint64_t row, int trace, uint64_t radius, uint64_t * win_r0, uint64_t * win_r1) {
+    // Re-run alignment over the rows [row-radius, row+radius], anchored on the
+    // instruction of the given trace at the given row, and splice the result
+    // back into the existing row mapping. Rows outside of the window are left
+    // as they are, so this only costs time proportional to the window size.
+    // The rows replaced are returned in [win_r0, win_r1), and the number of
+    // rows that took their place.
+    if (OPTIONS->num_traces < 2) {
+        return 0;
+    }
+    uint64_t r0 = (row > radius) ? row - radius : 0;
+    uint64_t r1 = row + radius + 1;
+    uint64_t n_insts = (TRACES[0]->n_insts > TRACES[1]->n_insts) ? TRACES[0]->n_insts : TRACES[1]->n_insts;
+    if (r1 > n_insts) r1 = n_insts;
+    if (r0 > r1) r0 = r1;
+    *win_r0 = r0;
+    *win_r1 = r1;
+
+    // Gather the real instructions of each trace that fall inside the window
+    instruction_t *list[2];
+    uint64_t *rows[2];
+    uint64_t len[2];
+    align_group_t *groups[2];
+    uint64_t n_groups[2];
+    for(int t = 0; t < 2; t++) {
+        len[t] = collect_window(TRACES[t], r0, r1, &list[t], &rows[t]);
+        n_groups[t] = build_groups(list[t], 0, len[t], &groups[t]);
+    }
+
+    // Find the group holding the anchor instruction, then the nearest group in
+    // the other trace that was committed with the same pc
+    int other = (trace == 0) ? 1 : 0;
+    int64_t anchor[2] = {-1, -1};
+    anchor[trace] = find_group(groups[trace], n_groups[trace], rows[trace], row);
+    if (anchor[trace] >= 0) {
+        align_group_t *g = &groups[trace][anchor[trace]];
+        uint64_t g_row = rows[trace][g->start];
+        uint64_t best_dist = UINT64_MAX;
+        for(uint64_t i = 0; i < n_groups[other]; i++) {
+            align_group_t *o = &groups[other][i];
+            if (o->key == NULL || strcmp(o->key, g->key) != 0) {
+                continue;
+            }
+            uint64_t o_row = rows[other][o->start];
+            uint64_t dist = (o_row > g_row) ? o_row - g_row : g_row - o_row;
+            if (dist < best_dist) {
+                best_dist = dist;
+                anchor[other] = i;
+            }
+        }
+    }
+
+    uint64_t n_rows = 0;
+    if (anchor[0] >= 0 && anchor[1] >= 0) {
+        // Align groups before the anchor, the anchor itself, then groups after it
+        uint64_t size = ((len[0] + len[1] > r1 - r0) ? len[0] + len[1] : r1 - r0) + 1;
+        int64_t *map_a = malloc(sizeof(int64_t) * size);
+        int64_t *map_b = malloc(sizeof(int64_t) * size);
+        instruction_t *out = malloc(sizeof(instruction_t) * size);
+        assert(map_a && map_b && out);
+        align_groups(groups[0], anchor[0], groups[1], anchor[1], map_a, map_b, &n_rows);
+        emit_group(&groups[0][anchor[0]], &groups[1][anchor[1]], map_a, map_b, &n_rows);
+        align_groups(groups[0] + anchor[0] + 1, n_groups[0] - anchor[0] - 1,
+                     groups[1] + anchor[1] + 1, n_groups[1] - anchor[1] - 1,
+                     map_a, map_b, &n_rows);
+        // A shorter alignment is padded out with empty rows, so the rows
+        // below keep their place and what is kept by row only needs the
+        // window redone
+        while(n_rows < r1 - r0) {
+            map_a[n_rows] = -1;
+            map_b[n_rows] = -1;
+            n_rows ++;
+        }
+        // Replace the window in each trace with the new rows
+        rows_from_map(list[0], map_a, n_rows, out);
+        splice_window(TRACES[0], r0, r1, out, n_rows);
+        rows_from_map(list[1], map_b, n_rows, out);
+        splice_window(TRACES[1], r0, r1, out, n_rows);
+        free(map_a);
+        free(map_b);
+        free(out);
+    } else {
+        fprintf(stderr, "realign: no matching committed instruction near row %" PRIu64 "\n", row);
+    }
+
+    for(int t = 0; t < 2; t++) {
+        free(list[t]);
+        free(rows[t]);
+        free(groups[t]);
+    }
+    return n_rows;
+}
+
+static uint64_t collect_window(trace_t * trace, uint64_t r0, uint64_t r1, instruction_t ** list, uint64_t ** rows) {
+    // Copy out the valid instructions in rows [r0, r1), remembering their rows
+    if (r1 > trace->n_insts) r1 = trace->n_insts;
+    uint64_t n = (r1 > r0) ? r1 - r0 : 0;
+    *list = malloc(sizeof(instruction_t) * (n + 1));
+    *rows = malloc(sizeof(uint64_t) * (n + 1));
+    assert(*list && *rows);
+    uint64_t len = 0;
+    for(uint64_t r = r0; r < r1; r++) {
+        if (trace->insts[r].valid) {
+            (*list)[len] = trace->insts[r];
+            (*rows)[len] = r;
+            len ++;
+        }
+    }
+    return len;
+}
 
+static uint64_t build_groups(instruction_t * list, uint64_t first, uint64_t len, align_group_t ** groups) {
+    // Split the list into groups, each starting at a committed instruction.
+    // Squashed instructions at the top of the list form a group with no key.
+    // Group starts are numbered from first.
+    *groups = malloc(sizeof(align_group_t) * (len + 1));
+    assert(*groups);
+    uint64_t n = 0;
+    for(uint64_t i = 0; i < len; i++) {
+        if (list[i].committed || n == 0) {
+            (*groups)[n].start = first + i;
+            (*groups)[n].len = 0;
+            (*groups)[n].key = list[i].committed ? list[i].pc_text : NULL;
+            n ++;
+        }
+        (*groups)[n-1].len ++;
+    }
+    return n;
 }
 
-static void shift_add_dummy(trace_t * trace, int dest_end, int src_end, int num_dummy, int num_shift) {
-    int to = dest_end;
-    for(int i = 0; i < num_dummy; i++) {
-        fill_dummy(&trace->insts[to--]);
+static int64_t find_group(align_group_t * groups, uint64_t n, uint64_t * rows, uint64_t row) {
+    // Find the committed group closest to the given row
+    int64_t best = -1;
+    uint64_t best_dist = UINT64_MAX;
+    for(uint64_t i = 0; i < n; i++) {
+        if (groups[i].key == NULL) {
+            continue;
+        }
+        uint64_t first = rows[groups[i].start];
+        uint64_t last = rows[groups[i].start + groups[i].len - 1];
+        uint64_t dist = 0;
+        if (row < first) dist = first - row;
+        if (row > last) dist = row - last;
+        if (dist < best_dist) {
+            best_dist = dist;
+            best = i;
+        }
     }
-    int from = src_end;
-    for(int i = 0; i < num_shift; i++) {
-        trace->insts[to--] = trace->insts[from--];
+    return best;
+}
+
+static bool group_match(align_group_t * a, align_group_t * b) {
+    if (a->key == NULL || b->key == NULL) {
+        return a->key == b->key;
     }
+    return strcmp(a->key, b->key) == 0;
 }
 
+static void align_groups(align_group_t * ga, uint64_t na, align_group_t * gb, uint64_t nb, int64_t * out_a, int64_t * out_b, uint64_t * n_out) {
+    // Longest common subsequence of the two group lists, keyed on committed pc
+    uint64_t w = nb + 1;
+    uint32_t * lcs = calloc((na + 1) * w, sizeof(uint32_t));
+    assert(lcs);
+    for(int64_t i = na - 1; i >= 0; i--) {
+        for(int64_t j = nb - 1; j >= 0; j--) {
+            if (group_match(&ga[i], &gb[j])) {
+                lcs[i*w + j] = lcs[(i+1)*w + (j+1)] + 1;
+            } else {
+                uint32_t down = lcs[(i+1)*w + j];
+                uint32_t right = lcs[i*w + (j+1)];
+                lcs[i*w + j] = (down > right) ? down : right;
+            }
+        }
+    }
+    // Walk the table, giving unmatched groups rows of their own
+    uint64_t i = 0;
+    uint64_t j = 0;
+    while(i < na || j < nb) {
+        if (i < na && j < nb && group_match(&ga[i], &gb[j])) {
+            emit_group(&ga[i], &gb[j], out_a, out_b, n_out);
+            i ++;   j ++;
+        } else if (j >= nb || (i < na && lcs[(i+1)*w + j] >= lcs[i*w + (j+1)])) {
+            emit_group(&ga[i], NULL, out_a, out_b, n_out);
+            i ++;
+        } else {
+            emit_group(NULL, &gb[j], out_a, out_b, n_out);
+            j ++;
+        }
+    }
+    free(lcs);
+}
 
+static void emit_group(align_group_t * ga, align_group_t * gb, int64_t * out_a, int64_t * out_b, uint64_t * n_out) {
+    // Lay a pair of groups out side by side, padding the shorter with dummies
+    // (a -1 in the row maps)
+    uint32_t len_a = (ga == NULL) ? 0 : ga->len;
+    uint32_t len_b = (gb == NULL) ? 0 : gb->len;
+    uint32_t len = (len_a > len_b) ? len_a : len_b;
+    for(uint32_t k = 0; k < len; k++) {
+        out_a[*n_out] = (k < len_a) ? (int64_t)(ga->start + k) : -1;
+        out_b[*n_out] = (k < len_b) ? (int64_t)(gb->start + k) : -1;
+        (*n_out) ++;
+    }
+}
 
+static void splice_window(trace_t * trace, uint64_t r0, uint64_t r1, instruction_t * rows, uint64_t n_rows) {
+    // Replace rows [r0, r1) of the trace with the given rows, moving the tail
+    if (r1 > trace->n_insts) r1 = trace->n_insts;
+    if (r0 > r1) r0 = r1;
+    uint64_t old_len = r1 - r0;
+    uint64_t tail = trace->n_insts - r1;
+    uint64_t new_size = trace->n_insts - old_len + n_rows;
+    if (n_rows > old_len) {
+        trace->insts = realloc(trace->insts, new_size*sizeof(instruction_t));
+        assert(trace->insts);
+    }
+    memmove(trace->insts + r0 + n_rows, trace->insts + r1, tail*sizeof(instruction_t));
+    memcpy(trace->insts + r0, rows, n_rows*sizeof(instruction_t));
+    trace->n_insts = new_size;
+}
 
 long trace_find_common(int *start_a, int *start_b, int *end_a, int *end_b) {
     // Find point in traces where the dynamic instructions line up
@@ -357,19 +625,6 @@ int find_commited(trace_t * trace, int * ind) {
     return len;
 }
 
-int find_commited_prev(trace_t * trace, int * ind) {
-    int len = 0;
-    while(*ind >= 0) {
-        if (trace->insts[*ind].committed)
-            break;
-        (*ind) --;
-        len ++;
-    }
-    return len;
-}
-
-
-
 trace_t * new_trace(char *name){
     trace_t * t = (trace_t*) malloc(sizeof(trace_t));
     assert(t);
@@ -382,30 +637,6 @@ trace_t * new_trace(char *name){
 
 
 
-static void remove_start(trace_t* trace, int len) {
-    // TODO: Free data in start instructions
-    int new_len = trace->n_insts - len;
-    memmove(trace->insts, trace->insts + len, new_len*sizeof(instruction_t));
-    trace->n_insts = new_len;
-}
-static void remove_end(trace_t* trace, int len) {
-    // TODO: Free data in end instructions
-    trace->n_insts = len;
-}
-
-static void add_dummy_nodes(trace_t * trace, int len, int pos) {
-    uint64_t new_size = trace->n_insts + len;
-    trace->insts = realloc(trace->insts, new_size*sizeof(instruction_t));
-    // Shift current instructions
-    memmove(trace->insts + (pos+len), trace->insts + pos, (trace->n_insts-pos)*sizeof(instruction_t));
-    trace->n_insts = new_size;
-    // Add dummy nodes
-    for(int i = pos; i < (pos+len); i++) {
-        instruction_t * inst = &trace->insts[i];
-        fill_dummy(inst);
-    }
-}
-
 static void fill_dummy(instruction_t * inst) {
     inst->stages = NULL;
     inst->n_stages = 0;
@@ -417,6 +648,24 @@ static void fill_dummy(instruction_t * inst) {
 }
 
 
+static void free_inst_data(instruction_t * inst) {
+    // Free the strings, stages and parameters read for an instruction
+    for(uint32_t s = 0; s < inst->n_stages; s++) {
+        stage_t * stage = &inst->stages[s];
+        for(uint32_t p = 0; p < stage->n_params; p++) {
+            free(stage->params[p].name);
+            free(stage->params[p].value);
+        }
+        free(stage->params);
+        free(stage->id_str);
+        free(stage->name);
+    }
+    free(inst->stages);
+    free(inst->pc_text);
+    free(inst->instruction);
+    fill_dummy(inst);
+}
+
 static char * get_file_ext(char * str) {
     char * str_search = str;
     // Find end of string
@@ -443,9 +692,11 @@ static void post_process_trace(int trace_id) {
     // Remove leading spaces from instruction names
     for(uint64_t i = 0; i < trace->n_insts; i++) {
         
+        // Moved down rather than skipped, so the text can still be freed
         instruction_t * inst = &trace->insts[i];
-        while(*inst->instruction == ' ') {
-            inst->instruction ++;
+        size_t lead = strspn(inst->instruction, " ");
+        if (lead > 0) {
+            memmove(inst->instruction, inst->instruction + lead, strlen(inst->instruction + lead) + 1);
         }
         
     }
@@ -43,6 +43,7 @@ void dump_trace(int);
 
 instruction_t * new_dummy_instruction();
 trace_t * new_trace(char *name);
+uint64_t realign_local(uint64_t row, int trace, uint64_t radius, uint64_t *win_r0, uint64_t *win_r1);
 
 extern trace_t **TRACES;
 
@@ -0,0 +1,241 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "dptv.h"
+#include "options.h"
+#include "trace_handler.h"
+#include "warp.h"
+
+// How far (in cycles) a matched instruction may stray from the current
+// segment before a new knot is started
+static const double warp_tolerance = 0.5;
+
+warp_t *WARP = NULL;
+
+static void add_knot(warp_t *, uint64_t *, double, double, uint64_t);
+static void fit_warp(uint64_t, uint64_t *, const warp_t *, uint64_t, int64_t);
+static double warp_lookup(double *, double *, uint64_t, double, uint64_t *);
+
+// Build the warp table from the aligned rows of the two traces
+void build_warp() {
+    free_warp();
+    if (OPTIONS->num_traces < 2) {
+        return;
+    }
+    WARP = malloc(sizeof(warp_t));
+    assert(WARP);
+    uint64_t size = 1024;
+    WARP->src = malloc(sizeof(double) * size);
+    WARP->dst = malloc(sizeof(double) * size);
+    WARP->row = malloc(sizeof(uint64_t) * size);
+    WARP->n = 0;
+    assert(WARP->src && WARP->dst && WARP->row);
+    fit_warp(0, &size, NULL, 0, 0);
+
+    printf("warp map: %" PRIu64 " knots\n", WARP->n);
+    fflush(stdout);
+}
+
+// Rows [r0, r1) were replaced by n_rows rows. The knots above them are kept,
+// and fitting starts again from the last of those until it lands on a knot
+// from below the window, past which the old table still holds.
+void splice_warp(uint64_t r0, uint64_t r1, uint64_t n_rows) {
+    if (WARP == NULL) {
+        return;
+    }
+    warp_t *old = WARP;
+    int64_t delta = (int64_t)n_rows - (int64_t)(r1 - r0);
+    // The last knot only marks where the rows ran out, it isn't kept
+    uint64_t keep = 0;
+    while (keep + 1 < old->n && old->row[keep] < r0) {
+        keep ++;
+    }
+    WARP = malloc(sizeof(warp_t));
+    assert(WARP);
+    uint64_t size = old->n + 1024;
+    WARP->src = malloc(sizeof(double) * size);
+    WARP->dst = malloc(sizeof(double) * size);
+    WARP->row = malloc(sizeof(uint64_t) * size);
+    assert(WARP->src && WARP->dst && WARP->row);
+    memcpy(WARP->src, old->src, sizeof(double) * keep);
+    memcpy(WARP->dst, old->dst, sizeof(double) * keep);
+    memcpy(WARP->row, old->row, sizeof(uint64_t) * keep);
+    WARP->n = keep;
+    fit_warp((keep > 0) ? old->row[keep-1] + 1 : 0, &size, old, r1, delta);
+    free(old->src);
+    free(old->dst);
+    free(old->row);
+    free(old);
+}
+
+void free_warp() {
+    if (WARP == NULL) return;
+    free(WARP->src);
+    free(WARP->dst);
+    free(WARP->row);
+    free(WARP);
+    WARP = NULL;
+}
+
+// Add knots for the matched rows from row r on, after the last knot in WARP.
+// With an old table, stop once a knot lands on the row of one of its knots
+// at or below row from, moved by delta, and copy the rest of them.
+static void fit_warp(uint64_t r, uint64_t *size, const warp_t *old, uint64_t from, int64_t delta) {
+    trace_t *a = TRACES[0];
+    trace_t *b = TRACES[1];
+    uint64_t n_rows = (a->n_insts < b->n_insts) ? a->n_insts : b->n_insts;
+    uint64_t j = 0;
+    while (old != NULL && j < old->n && old->row[j] < from) {
+        j ++;
+    }
+
+    // Candidate point that may still be folded into the current segment, and
+    // the range of slopes from the last knot that keep every point passed
+    // since then within tolerance
+    bool have_cand = false;
+    double cand_src = 0, cand_dst = 0;
+    uint64_t cand_row = 0;
+    double slope_lo = -INFINITY, slope_hi = INFINITY;
+    for(; r < n_rows; r++) {
+        instruction_t *ia = &a->insts[r];
+        instruction_t *ib = &b->insts[r];
+        if (!ia->valid || !ib->valid || !ia->committed || !ib->committed) continue;
+        if (ia->n_stages == 0 || ib->n_stages == 0) continue;
+        if (strcmp(ia->pc_text, ib->pc_text) != 0) continue;
+        double s = ib->stages[0].cycle;
+        double d = ia->stages[0].cycle;
+        // Keep the map strictly increasing in both directions
+        double last_s = have_cand ? cand_src : (WARP->n ? WARP->src[WARP->n-1] : -1);
+        double last_d = have_cand ? cand_dst : (WARP->n ? WARP->dst[WARP->n-1] : -1);
+        if (s <= last_s || d <= last_d) continue;
+        if (WARP->n == 0) {
+            add_knot(WARP, size, s, d, r);
+            continue;
+        }
+        double ks = WARP->src[WARP->n-1];
+        double kd = WARP->dst[WARP->n-1];
+        double slope = (d - kd) / (s - ks);
+        if (have_cand && (slope < slope_lo || slope > slope_hi)) {
+            // This point can't share a segment with the ones before it, end
+            // the segment at the candidate
+            add_knot(WARP, size, cand_src, cand_dst, cand_row);
+            // Fitting from the same knot over the same rows as before gives
+            // the same knots as before
+            while (old != NULL && j < old->n && (int64_t)old->row[j] + delta < (int64_t)cand_row) {
+                j ++;
+            }
+            if (old != NULL && j < old->n && (int64_t)old->row[j] + delta == (int64_t)cand_row) {
+                for(j++; j < old->n; j++) {
+                    add_knot(WARP, size, old->src[j], old->dst[j], old->row[j] + delta);
+                }
+                have_cand = false;
+                break;
+            }
+            ks = cand_src;
+            kd = cand_dst;
+            slope_lo = -INFINITY;
+            slope_hi = INFINITY;
+        }
+        double lo = (d - warp_tolerance - kd) / (s - ks);
+        double hi = (d + warp_tolerance - kd) / (s - ks);
+        if (lo > slope_lo) slope_lo = lo;
+        if (hi < slope_hi) slope_hi = hi;
+        cand_src = s;
+        cand_dst = d;
+        cand_row = r;
+        have_cand = true;
+    }
+    if (have_cand) {
+        add_knot(WARP, size, cand_src, cand_dst, cand_row);
+    }
+    WARP->src = realloc(WARP->src, sizeof(double) * (WARP->n + 1));
+    WARP->dst = realloc(WARP->dst, sizeof(double) * (WARP->n + 1));
+    WARP->row = realloc(WARP->row, sizeof(uint64_t) * (WARP->n + 1));
+}
+
+static void add_knot(warp_t *w, uint64_t *size, double s, double d, uint64_t row) {
+    if (w->n >= *size) {
+        *size = *size * 2;
+        w->src = realloc(w->src, sizeof(double) * *size);
+        w->dst = realloc(w->dst, sizeof(double) * *size);
+        w->row = realloc(w->row, sizeof(uint64_t) * *size);
+        assert(w->src && w->dst && w->row);
+    }
+    w->src[w->n] = s;
+    w->dst[w->n] = d;
+    w->row[w->n] = row;
+    w->n ++;
+}
+
+// Cycle in the second trace to cycle in the first
+double warp_map(double cycle, uint64_t *hint) {
+    return warp_lookup(WARP->src, WARP->dst, WARP->n, cycle, hint);
+}
+
+// Cycle in the first trace to cycle in the second
+double warp_unmap(double cycle, uint64_t *hint) {
+    return warp_lookup(WARP->dst, WARP->src, WARP->n, cycle, hint);
+}
+
+static double warp_lookup(double *from, double *to, uint64_t n, double x, uint64_t *hint) {
+    if (n == 0) return x;
+    if (n == 1) return x - from[0] + to[0];
+    // Find segment i such that from[i] <= x < from[i+1], trying the hint first
+    uint64_t i;
+    if (hint != NULL && *hint + 1 < n && from[*hint] <= x && x < from[*hint + 1]) {
+        i = *hint;
+    } else if (x < from[0]) {
+        i = 0;
+    } else if (x >= from[n-1]) {
+        i = n - 2;
+    } else {
+        uint64_t lo = 0;
+        uint64_t hi = n - 1;
+        while(hi - lo > 1) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (from[mid] <= x) lo = mid;
+            else                hi = mid;
+        }
+        i = lo;
+    }
+    if (hint != NULL) *hint = i;
+    // Interpolate, extending the end segments past the ends of the table
+    double slope = (to[i+1] - to[i]) / (from[i+1] - from[i]);
+    return to[i] + (x - from[i]) * slope;
+}
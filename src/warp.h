@@ -0,0 +1,59 @@
+  /* This file is part of the Dual PipeTrace Viewer (dptv) pipeline 
+   * trace visualization tool. The dptv project was written by Adam 
+   * Grunwald and Elliott Forbes, University of Wisconsin-La Crosse, 
+   * copyright 2021-2025.
+   *
+   * dptv is free software: you can redistribute it and/or modify it
+   * under the terms of the GNU General Public License as published 
+   * by the Free Software Foundation, either version 3 of the License, 
+   * or (at your option) any later version.
+   *
+   * dptv is distributed in the hope that it will be useful, but 
+   * WITHOUT ANY WARRANTY; without even the implied warranty of 
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+   * General Public License for more details.
+   *
+   * You should have received a copy of the GNU General Public License 
+   * along with dptv. If not, see <https://www.gnu.org/licenses/>. 
+   *
+   *
+   *
+   * The dptv project can be found at https://cs.uwlax.edu/~eforbes/dptv/
+   *
+   * If you use dptv in your published research, please consider 
+   * citing the following:
+   *
+   * Grunwald, A., Nguyen, P. and Forbes, E., "dptv: A New PipeTrace
+   * Viewer for Microarchitectural Analysis," Proceedings of the 55th 
+   * Midwest Instruction and Computing Symposium, April 2023. 
+   *
+   * If you found dptv helpful, please let us know! Email eforbes@uwlax.edu
+   *
+   * There are bound to be bugs, let us know those too.
+   */
+
+#ifndef _WARP_H_
+#define _WARP_H_
+
+#include <stdint.h>
+#include "dptv.h"
+
+// Piecewise-linear map from cycles of the second trace to cycles of the
+// first, built from the fetch cycles of matched committed instructions.
+// Both knot arrays are strictly increasing so the map can be inverted.
+typedef struct warp_type {
+    double *src;
+    double *dst;
+    uint64_t *row;          // row of the instructions each knot is taken from
+    uint64_t n;
+} warp_t;
+
+void build_warp();
+void splice_warp(uint64_t r0, uint64_t r1, uint64_t n_rows);
+void free_warp();
+double warp_map(double cycle, uint64_t *hint);
+double warp_unmap(double cycle, uint64_t *hint);
+
+extern warp_t *WARP;
+
+#endif